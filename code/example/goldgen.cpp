@@ -1,11 +1,12 @@
 #include"../library/goldreich.hpp"
+#include"../library/prg.hpp"
 #include<cstdio>
 #include<ctime>
 
 bool ParseCommandLine(int const argc, char ** const argv);
 void PrintUsage();
 
-typedef std::mt19937 RNG;
+typedef Cryptography::Prg::ChaCha20Generator RNG;
 
 Cryptography::Goldreich::GoldreichGraph<> gg;
 RNG rng((unsigned)time(nullptr));
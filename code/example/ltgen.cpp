@@ -4,6 +4,7 @@
 #include"../library/luby.hpp"
 #include"../library/erasure.hpp"
 #include"../library/cryptography.hpp"
+#include"../library/prg.hpp"
 #include<random>
 #include<cstdlib>
 #include<cstring>
@@ -17,7 +18,7 @@ constexpr unsigned SmallSampleSize = 500;
 constexpr unsigned LargeSampleSize = 20000;
 
 typedef Cryptography::Z<4294967291u> Zp;
-typedef std::mt19937 RNG;
+typedef Cryptography::Prg::ChaCha20Generator RNG;
 
 char const *ofn;
 unsigned w;
@@ -26,7 +27,7 @@ unsigned v, vErased;
 bool *boolArray;
 Zp *plain, *encoded, *decoded;
 RNG rng((unsigned)time(nullptr));
-std::uniform_int_distribution<uint32_t> UZp(0u, 4294967290u);
+Cryptography::Prg::UniformRingDistribution<Zp> UZp;
 
 bool ParseCommandLine(int const argc, char ** const argv);
 void PrintUsage();
@@ -171,11 +172,12 @@ void PrintUsage()
 
 double TestLTCode(LTCode<> const &code, unsigned const count)
 {
-    LTCode<> surrogate;
+    LTPeelingIndex index;
+    LTDecodeWorkspace<Zp> workspace;
+    code.BuildPeelingIndex(index);
     unsigned success = 0u;
     for (unsigned i = 0u; i != count; ++i)
     {
-        memset(boolArray, false, w * sizeof(bool));
         memset(boolArray + w, true, v * sizeof(bool));
         for (unsigned j = 0u; j != w; ++j)
             plain[j] = UZp(rng);
@@ -183,13 +185,11 @@ double TestLTCode(LTCode<> const &code, unsigned const count)
         for (unsigned j = 0u; j != v; ++j)
             encoded[j] = 0;
         code.Encode(encoded, (bool const *)boolArray + w, (Zp const *)plain);
-        surrogate = code;
-        if (!surrogate.DecodeDestructive
+        if (!code.DecodePeeling
         (
-            boolArray, boolArray + w,
-            decoded,
-            boolArray + w, boolArray + w + v,
-            encoded, encoded + v
+            index, decoded,
+            (bool const *)boolArray + w,
+            (Zp const *)encoded, workspace
         ))
             continue;
         for (unsigned j = 0u; j != w; ++j)
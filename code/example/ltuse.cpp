@@ -60,11 +60,12 @@ void PrintUsage()
 
 double TestLTCode(LTCode<> const &code, unsigned const count)
 {
-    LTCode<> surrogate;
+    LTPeelingIndex index;
+    LTDecodeWorkspace<Zp> workspace;
+    code.BuildPeelingIndex(index);
     unsigned success = 0u;
     for (unsigned i = 0u; i != count; ++i)
     {
-        memset(boolArray, false, w * sizeof(bool));
         memset(boolArray + w, true, v * sizeof(bool));
         for (unsigned j = 0u; j != w; ++j)
             plain[j] = UZp(rng);
@@ -72,13 +73,11 @@ double TestLTCode(LTCode<> const &code, unsigned const count)
         for (unsigned j = 0u; j != v; ++j)
             encoded[j] = 0;
         code.Encode(encoded, (bool const *)boolArray + w, (Zp const *)plain);
-        surrogate = code;
-        if (!surrogate.DecodeDestructive
+        if (!code.DecodePeeling
         (
-            boolArray, boolArray + w,
-            decoded,
-            boolArray + w, boolArray + w + v,
-            encoded, encoded + v
+            index, decoded,
+            (bool const *)boolArray + w,
+            (Zp const *)encoded, workspace
         ))
             continue;
         for (unsigned j = 0u; j != w; ++j)
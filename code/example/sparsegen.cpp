@@ -4,11 +4,13 @@
 #include"../library/sparse_code.hpp"
 #include"../library/erasure.hpp"
 #include"../library/cryptography.hpp"
+#include"../library/prg.hpp"
 #include<random>
 #include<cstdlib>
 #include<cstring>
 #include<ctime>
 #include<algorithm>
+#include<thread>
 
 using namespace Encoding::Erasure;
 using namespace Encoding::SparseLinearCode;
@@ -17,7 +19,7 @@ constexpr unsigned SmallSampleSize = 500;
 constexpr unsigned LargeSampleSize = 20000;
 
 typedef Cryptography::Z<4294967291u> Zp;
-typedef std::mt19937 RNG;
+typedef Cryptography::Prg::ChaCha20Generator RNG;
 
 typedef FastSparseLinearCode<Zp> FSLCode;
 
@@ -26,7 +28,7 @@ unsigned k, d, u, uErased, v, vErased;
 bool *boolArray;
 Zp *plain, *encoded, *decoded, *tempMatrix;
 RNG rng((unsigned)time(nullptr));
-std::uniform_int_distribution<uint32_t> UZp(0u, 4294967290u);
+Cryptography::Prg::UniformRingDistribution<Zp> UZp;
 
 bool ParseCommandLine(int const argc, char ** const argv);
 void PrintUsage();
@@ -47,6 +49,8 @@ int main(int argc, char **argv)
         PrintUsage();
         return -1;
     }
+    Concurrency::WorkStealingThreadPool pool(std::max(std::thread::hardware_concurrency(), 2u) - 1);
+    Cryptography::GaussianElimination::ThreadPool() = &pool;
     FSLCode code;
     code.K = k;
     code.D = d;
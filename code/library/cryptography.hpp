@@ -87,11 +87,79 @@ namespace Cryptography
         }
     }
 
+    namespace ReductionImpl_
+    {
+        /* Computes x mod p for 0<=x<2p.
+         * The mask keeps the code free of branches,
+         * which would be mispredicted half of the time.
+         */
+        template <typename TBaseType, typename TPromotedType>
+        constexpr TBaseType ConditionalSubtract(TPromotedType x, TBaseType p)
+        {
+            return (TBaseType)(x - ((TPromotedType)p
+                & ((TPromotedType)0 - (TPromotedType)(x >= p))));
+        }
+
+        /* p=2^32-c with c<=2^15 and 32/64-bit types. */
+        template <uint32_t p, typename TBaseType, typename TPromotedType>
+        struct IsPseudoMersenne
+        {
+            static constexpr bool Value = sizeof(TBaseType) == 4
+                && sizeof(TPromotedType) == 8
+                && p >= (uint32_t)0xFFFF8000u;
+        };
+
+        template
+        <
+            uint32_t p, typename TBaseType, typename TPromotedType,
+            bool = IsPseudoMersenne<p, TBaseType, TPromotedType>::Value
+        >
+        struct Reducer
+        {
+            static constexpr TPromotedType PartialBound()
+            {
+                return p;
+            }
+            static constexpr TPromotedType Partial(TPromotedType x)
+            {
+                return x % p;
+            }
+            static constexpr TBaseType Full(TPromotedType x)
+            {
+                return (TBaseType)(x % p);
+            }
+        };
+
+        /* Write x=h*2^32+l, then x=h*c+l mod p.
+         * One fold maps [0,2^64) into [0,2^32*(c+1)),
+         * two folds map it into [0,c*(c+1)+2^32), which is
+         * within [0,2p) since c<=2^15, so that a conditional
+         * subtraction finishes the reduction.
+         */
+        template <uint32_t p, typename TBaseType, typename TPromotedType>
+        struct Reducer<p, TBaseType, TPromotedType, true>
+        {
+            static constexpr TPromotedType C = ((TPromotedType)0 - p) & 0xFFFFFFFFu;
+            static constexpr TPromotedType PartialBound()
+            {
+                return (C + 1) << 32;
+            }
+            static constexpr TPromotedType Partial(TPromotedType x)
+            {
+                return (x >> 32) * C + (x & 0xFFFFFFFFu);
+            }
+            static constexpr TBaseType Full(TPromotedType x)
+            {
+                return ConditionalSubtract<TBaseType, TPromotedType>(Partial(Partial(x)), p);
+            }
+        };
+    }
+
     template <uint32_t p, typename TBaseType = uint32_t, typename TPromotedType = uint64_t>
     struct Z
     {
         constexpr Z() : raw_value(0) { }
-        constexpr Z(TPromotedType raw) : raw_value((TBaseType)(raw % p)) { }
+        constexpr Z(TPromotedType raw) : raw_value(Reducer::Full(raw)) { }
         constexpr Z(Z &&) = default;
         constexpr Z(Z const &) = default;
         Z &operator = (Z &&) = default;
@@ -146,15 +214,18 @@ namespace Cryptography
         }
         friend constexpr Z operator + (Z const a, Z const b)
         {
-            return (TPromotedType)a.raw_value + b.raw_value;
+            return FromRaw(ReductionImpl_::ConditionalSubtract<TBaseType, TPromotedType>(
+                (TPromotedType)a.raw_value + b.raw_value, p));
         }
         friend constexpr Z operator - (Z const a)
         {
-            return p - a.raw_value;
+            return FromRaw(ReductionImpl_::ConditionalSubtract<TBaseType, TPromotedType>(
+                (TPromotedType)p - a.raw_value, p));
         }
         friend constexpr Z operator - (Z const a, Z const b)
         {
-            return (TPromotedType)p - b.raw_value + a.raw_value;
+            return FromRaw(ReductionImpl_::ConditionalSubtract<TBaseType, TPromotedType>(
+                (TPromotedType)p - b.raw_value + a.raw_value, p));
         }
         friend constexpr Z operator * (Z const a, Z const b)
         {
@@ -170,10 +241,326 @@ namespace Cryptography
         {
             return a * b.Inverse();
         }
+        /* Square-and-multiply. The sequence of operations depends only
+         * on e, not on the element.
+         */
+        Z Power(TPromotedType e) const
+        {
+            Z result = 1u, base = *this;
+            for (; e; e >>= 1, base = base * base)
+                if (e & 1)
+                    result = result * base;
+            return result;
+        }
+        /* Fermat inverse, valid only if p is a prime. */
+        Z InverseByExponentiation() const
+        {
+            return Power(p - 2);
+        }
+        /* Lazy reduction: returns a value congruent to raw modulo p
+         * and less than PartialReduceBound(). Products of two elements
+         * can be partially reduced and summed in TPromotedType as long
+         * as the sum does not overflow, then converted to Z once.
+         */
+        static constexpr TPromotedType PartialReduce(TPromotedType raw)
+        {
+            return Reducer::Partial(raw);
+        }
+        static constexpr TPromotedType PartialReduceBound()
+        {
+            return Reducer::PartialBound();
+        }
     private:
+        typedef ReductionImpl_::Reducer<p, TBaseType, TPromotedType> Reducer;
+        struct RawTag { };
+        constexpr Z(RawTag, TBaseType raw) : raw_value(raw) { }
+        static constexpr Z FromRaw(TBaseType raw)
+        {
+            return Z(RawTag(), raw);
+        }
         TBaseType raw_value;
     };
 
+    namespace MontgomeryImpl_
+    {
+        /* Computes x such that n*x=1 mod 2^(bits of TUInt).
+         * Each step of Newton's iteration doubles the number
+         * of correct low bits. Starting with x=n is correct
+         * to 3 bits for any odd n.
+         */
+        template <typename TUInt>
+        constexpr TUInt InverseModPowerOfTwo(TUInt n, TUInt x = 0, size_t correctBits = 0)
+        {
+            return correctBits == 0
+                ? InverseModPowerOfTwo<TUInt>(n, n, 3)
+                : correctBits >= sizeof(TUInt) * 8
+                ? x
+                : InverseModPowerOfTwo<TUInt>(n,
+                    (TUInt)(x * (TUInt)((TUInt)2 - (TUInt)(n * x))),
+                    correctBits * 2);
+        }
+
+        /* Computes t/R mod p for 0<=t<pR, where R=2^(bits of TBaseType)
+         * and pInv*p=1 mod R.
+         * Let m=t*pInv mod R, then t-mp is divisible by R and
+         * (t-mp)/R=floor(t/R)-floor(mp/R) lies in (-p,p),
+         * because the low halves of t and mp coincide.
+         */
+        template <typename TBaseType, typename TPromotedType>
+        constexpr TBaseType Reduce(TPromotedType t, TBaseType p, TBaseType pInv)
+        {
+            return ReductionImpl_::ConditionalSubtract<TBaseType, TPromotedType>(
+                (TPromotedType)p
+                + (TBaseType)(t >> (sizeof(TBaseType) * 8))
+                - (TBaseType)(((TPromotedType)(TBaseType)((TBaseType)t * pInv) * p)
+                    >> (sizeof(TBaseType) * 8)),
+                p);
+        }
+
+        template <uint32_t p, typename TBaseType, typename TPromotedType>
+        struct Constants
+        {
+            static constexpr TBaseType PInv()
+            {
+                return InverseModPowerOfTwo<TBaseType>((TBaseType)p);
+            }
+            /* R mod p */
+            static constexpr TPromotedType R1()
+            {
+                return ((TPromotedType)1 << (sizeof(TBaseType) * 8)) % p;
+            }
+            /* R^2 mod p */
+            static constexpr TPromotedType R2()
+            {
+                return R1() * R1() % p;
+            }
+            /* R^3 mod p */
+            static constexpr TPromotedType R3()
+            {
+                return R2() * R1() % p;
+            }
+        };
+    }
+
+    /* Same interface as Z<p>, but the element a is stored as aR mod p
+     * so that multiplication needs no division.
+     * p must be odd.
+     */
+    template <uint32_t p, typename TBaseType = uint32_t, typename TPromotedType = uint64_t>
+    struct ZMontgomery
+    {
+        constexpr ZMontgomery() : raw_value(0) { }
+        constexpr ZMontgomery(TPromotedType raw)
+            : raw_value(MontgomeryImpl_::Reduce<TBaseType, TPromotedType>(
+                raw % p * Constants::R2(), p, Constants::PInv()))
+        { }
+        constexpr ZMontgomery(ZMontgomery &&) = default;
+        constexpr ZMontgomery(ZMontgomery const &) = default;
+        ZMontgomery &operator = (ZMontgomery &&) = default;
+        ZMontgomery &operator = (ZMontgomery const &) = default;
+        friend constexpr bool operator == (ZMontgomery a, ZMontgomery b)
+        {
+            return a.raw_value == b.raw_value;
+        }
+        friend constexpr bool operator != (ZMontgomery a, ZMontgomery b)
+        {
+            return a.raw_value != b.raw_value;
+        }
+        friend constexpr bool operator == (ZMontgomery a, TBaseType b)
+        {
+            return (TBaseType)a == b % p;
+        }
+        friend constexpr bool operator != (ZMontgomery a, TBaseType b)
+        {
+            return (TBaseType)a != b % p;
+        }
+        friend constexpr bool operator == (TBaseType b, ZMontgomery a)
+        {
+            return (TBaseType)a == b % p;
+        }
+        friend constexpr bool operator != (TBaseType b, ZMontgomery a)
+        {
+            return (TBaseType)a != b % p;
+        }
+        constexpr operator TBaseType () const
+        {
+            return MontgomeryImpl_::Reduce<TBaseType, TPromotedType>(
+                raw_value, p, Constants::PInv());
+        }
+        constexpr operator bool () const
+        {
+            return raw_value;
+        }
+        constexpr bool operator ! () const
+        {
+            return !raw_value;
+        }
+        friend ZMontgomery &operator += (ZMontgomery &lhs, ZMontgomery const rhs)
+        {
+            return lhs = lhs + rhs;
+        }
+        friend ZMontgomery &operator -= (ZMontgomery &lhs, ZMontgomery const rhs)
+        {
+            return lhs = lhs - rhs;
+        }
+        friend ZMontgomery &operator *= (ZMontgomery &lhs, ZMontgomery const rhs)
+        {
+            return lhs = lhs * rhs;
+        }
+        friend constexpr ZMontgomery operator + (ZMontgomery const a, ZMontgomery const b)
+        {
+            return FromRaw(ReductionImpl_::ConditionalSubtract<TBaseType, TPromotedType>(
+                (TPromotedType)a.raw_value + b.raw_value, p));
+        }
+        friend constexpr ZMontgomery operator - (ZMontgomery const a)
+        {
+            return FromRaw(ReductionImpl_::ConditionalSubtract<TBaseType, TPromotedType>(
+                (TPromotedType)p - a.raw_value, p));
+        }
+        friend constexpr ZMontgomery operator - (ZMontgomery const a, ZMontgomery const b)
+        {
+            return FromRaw(ReductionImpl_::ConditionalSubtract<TBaseType, TPromotedType>(
+                (TPromotedType)p - b.raw_value + a.raw_value, p));
+        }
+        friend constexpr ZMontgomery operator * (ZMontgomery const a, ZMontgomery const b)
+        {
+            return FromRaw(MontgomeryImpl_::Reduce<TBaseType, TPromotedType>(
+                (TPromotedType)a.raw_value * b.raw_value, p, Constants::PInv()));
+        }
+        /* EEInv gives (aR)^-1, and Reduce((aR)^-1 R^3) = a^-1 R. */
+        ZMontgomery Inverse() const
+        {
+            TBaseType inv = 0;
+            ExtendedEuclideanImpl_::EEInv(raw_value, p, inv);
+            return FromRaw(MontgomeryImpl_::Reduce<TBaseType, TPromotedType>(
+                inv * Constants::R3(), p, Constants::PInv()));
+        }
+        friend ZMontgomery operator / (ZMontgomery const a, ZMontgomery const b)
+        {
+            return a * b.Inverse();
+        }
+        /* Square-and-multiply. The sequence of operations depends only
+         * on e, not on the element.
+         */
+        ZMontgomery Power(TPromotedType e) const
+        {
+            ZMontgomery result = 1u, base = *this;
+            for (; e; e >>= 1, base = base * base)
+                if (e & 1)
+                    result = result * base;
+            return result;
+        }
+        /* Fermat inverse, valid only if p is a prime. */
+        ZMontgomery InverseByExponentiation() const
+        {
+            return Power(p - 2);
+        }
+    private:
+        typedef MontgomeryImpl_::Constants<p, TBaseType, TPromotedType> Constants;
+        struct RawTag { };
+        constexpr ZMontgomery(RawTag, TBaseType raw) : raw_value(raw) { }
+        static constexpr ZMontgomery FromRaw(TBaseType raw)
+        {
+            return ZMontgomery(RawTag(), raw);
+        }
+        TBaseType raw_value;
+    };
+
+    /* Accumulates sums of elements and of products of elements,
+     * reducing once when the result is taken.
+     * Capacity() is the number of terms, including the initial value,
+     * that can be accumulated safely.
+     */
+    template <typename TRing>
+    struct Accumulator
+    {
+        explicit Accumulator(TRing const &initial) : sum(initial) { }
+        static constexpr size_t Capacity()
+        {
+            return (size_t)0 - (size_t)1;
+        }
+        void Add(TRing const &a)
+        {
+            sum += a;
+        }
+        void AddProduct(TRing const &a, TRing const &b)
+        {
+            sum += a * b;
+        }
+        TRing Result() const
+        {
+            return sum;
+        }
+    private:
+        TRing sum;
+    };
+
+    /* Each term is partially reduced and summed in TPromotedType. */
+    template <uint32_t p, typename TBaseType, typename TPromotedType>
+    struct Accumulator<Z<p, TBaseType, TPromotedType>>
+    {
+        typedef Z<p, TBaseType, TPromotedType> ZType;
+        explicit Accumulator(ZType const initial) : sum((TBaseType)initial) { }
+        static constexpr size_t Capacity()
+        {
+            return ((TPromotedType)0 - 1) / ZType::PartialReduceBound()
+                    > (TPromotedType)((size_t)0 - (size_t)1)
+                ? (size_t)0 - (size_t)1
+                : (size_t)(((TPromotedType)0 - 1) / ZType::PartialReduceBound());
+        }
+        void Add(ZType const a)
+        {
+            sum += (TBaseType)a;
+        }
+        void AddProduct(ZType const a, ZType const b)
+        {
+            sum += ZType::PartialReduce((TPromotedType)(TBaseType)a * (TBaseType)b);
+        }
+        ZType Result() const
+        {
+            return sum;
+        }
+    private:
+        TPromotedType sum;
+    };
+
+    /* Montgomery's trick: replaces each of the n elements of values
+     * by its inverse with a single call to inverse and 3(n - 1)
+     * multiplications. scratch = TRing[n]. Returns false and leaves
+     * values unchanged if any element is zero.
+     */
+    template
+    <
+        typename TRandomAccessInputOutputIt1,
+        typename TRandomAccessInputOutputIt2,
+        typename TInverseFunctor
+    >
+    bool BatchInverse
+    (
+        size_t n,
+        TRandomAccessInputOutputIt1 values,
+        TRandomAccessInputOutputIt2 scratch,
+        TInverseFunctor inverse
+    )
+    {
+        if (!n)
+            return true;
+        scratch[0] = values[0];
+        for (size_t i = 1; i != n; ++i)
+            scratch[i] = scratch[i - 1] * values[i];
+        if (!(bool)scratch[n - 1])
+            return false;
+        auto acc = inverse(scratch[n - 1]);
+        for (size_t i = n - 1; i; --i)
+        {
+            auto inv = acc * scratch[i - 1];
+            acc = acc * values[i];
+            values[i] = inv;
+        }
+        values[0] = acc;
+        return true;
+    }
+
 }
 
 #endif // CRYPTOGRAPHY_HPP_
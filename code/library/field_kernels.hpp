@@ -0,0 +1,1066 @@
+#ifndef FIELD_KERNELS_HPP_
+#define FIELD_KERNELS_HPP_
+
+#include<cstddef>
+#include<cstdint>
+#include"cryptography.hpp"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define FIELD_KERNELS_X86_
+#include<immintrin.h>
+#ifdef _MSC_VER
+#include<intrin.h>
+/* MSVC accepts the intrinsics without target options. */
+#define FIELD_KERNELS_AVX2_
+#define FIELD_KERNELS_AVX512_
+#else
+#define FIELD_KERNELS_AVX2_ __attribute__((target("avx2")))
+#define FIELD_KERNELS_AVX512_ __attribute__((target("avx512f")))
+#endif // _MSC_VER
+#endif // x86
+
+namespace Cryptography
+{
+namespace FieldKernels
+{
+    namespace InstructionSet
+    {
+        typedef size_t Type;
+        constexpr Type Scalar = 0;
+        constexpr Type AVX2 = 1;
+        constexpr Type AVX512 = 2;
+    }
+
+    inline InstructionSet::Type DetectInstructionSet()
+    {
+#ifndef FIELD_KERNELS_X86_
+        return InstructionSet::Scalar;
+#elif defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+            return InstructionSet::Scalar;
+        __cpuid(info, 1);
+        /* OSXSAVE and AVX */
+        if ((info[2] & (3 << 27)) != (3 << 27))
+            return InstructionSet::Scalar;
+        auto const xcr0 = _xgetbv(0);
+        /* XMM and YMM states */
+        if ((xcr0 & 6) != 6)
+            return InstructionSet::Scalar;
+        __cpuidex(info, 7, 0);
+        if (!(info[1] & (1 << 5)))
+            return InstructionSet::Scalar;
+        /* AVX-512F, then opmask, ZMM_Hi256 and Hi16_ZMM states */
+        if ((info[1] & (1 << 16)) && (xcr0 & 0xE0) == 0xE0)
+            return InstructionSet::AVX512;
+        return InstructionSet::AVX2;
+#else
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f"))
+            return InstructionSet::AVX512;
+        if (__builtin_cpu_supports("avx2"))
+            return InstructionSet::AVX2;
+        return InstructionSet::Scalar;
+#endif
+    }
+
+    /* The instruction set used by the kernels.
+     * It is detected on first use and can be lowered
+     * (but must not be raised) by assigning to the reference.
+     */
+    inline InstructionSet::Type &ActiveInstructionSet()
+    {
+        static InstructionSet::Type active = DetectInstructionSet();
+        return active;
+    }
+
+    /* The rows of a sparse matrix for AddSparseProducts are stored by
+     * blocks of SparseBlockRows rows; in a block of D entries per row,
+     * entry t of row r is at t * SparseBlockRows + r, so that the
+     * entries of a block are loaded SparseBlockRows rows at a time.
+     */
+    constexpr size_t SparseBlockRows = 16;
+
+    namespace FieldKernelsImpl_
+    {
+        /* Additive: elements are uint32_t less than P,
+         *     and addition is addition modulo P.
+         * Multiplicative: additionally, multiplication is
+         *     multiplication modulo P = 2^32-C, C <= 2^15.
+         */
+        template <typename TRing>
+        struct SimdTraits
+        {
+            static constexpr bool Additive = false;
+            static constexpr bool Multiplicative = false;
+            static constexpr uint32_t P = 0;
+        };
+
+        template <uint32_t p>
+        struct SimdTraits<Z<p, uint32_t, uint64_t>>
+        {
+            static constexpr bool Additive = true;
+            static constexpr bool Multiplicative =
+                ReductionImpl_::IsPseudoMersenne<p, uint32_t, uint64_t>::Value;
+            static constexpr uint32_t P = p;
+        };
+
+        template <uint32_t p>
+        struct SimdTraits<ZMontgomery<p, uint32_t, uint64_t>>
+        {
+            static constexpr bool Additive = true;
+            static constexpr bool Multiplicative = false;
+            static constexpr uint32_t P = p;
+        };
+
+        template <typename TRing>
+        struct Scalar
+        {
+            static void Add(TRing *dst, TRing const *a, TRing const *b, size_t n)
+            {
+                for (size_t i = 0; i != n; ++i)
+                    dst[i] = a[i] + b[i];
+            }
+            static void Subtract(TRing *dst, TRing const *a, TRing const *b, size_t n)
+            {
+                for (size_t i = 0; i != n; ++i)
+                    dst[i] = a[i] - b[i];
+            }
+            static void Negate(TRing *dst, TRing const *a, size_t n)
+            {
+                for (size_t i = 0; i != n; ++i)
+                    dst[i] = -a[i];
+            }
+            static void Scale(TRing *dst, TRing const *a, TRing const s, size_t n)
+            {
+                for (size_t i = 0; i != n; ++i)
+                    dst[i] = a[i] * s;
+            }
+            static void Axpy(TRing *dst, TRing const s, TRing const *x, size_t n)
+            {
+                for (size_t i = 0; i != n; ++i)
+                    dst[i] += s * x[i];
+            }
+            static void MultiplyAdd(TRing *dst, TRing const *a, TRing const *b, TRing const *c, size_t n)
+            {
+                for (size_t i = 0; i != n; ++i)
+                    dst[i] = a[i] * b[i] + c[i];
+            }
+            static void SubtractCombination(TRing *dst, TRing const *coefficients,
+                TRing const *sources, size_t stride, size_t count, size_t n)
+            {
+                typedef Accumulator<TRing> TAccumulator;
+                size_t const capacity = TAccumulator::Capacity() - 1;
+                for (size_t i = 0; i != n; ++i)
+                {
+                    TAccumulator sum(TRing(0));
+                    for (size_t t = 0, left = capacity; t != count; ++t, --left)
+                    {
+                        if (!left)
+                        {
+                            sum = TAccumulator(sum.Result());
+                            left = capacity - 1;
+                        }
+                        sum.AddProduct(coefficients[t], sources[t * stride + i]);
+                    }
+                    dst[i] -= sum.Result();
+                }
+            }
+            /* the rows are taken from begin on */
+            static void AddCombinationOfRows(TRing *dst, TRing const *coefficients,
+                TRing const *const *sources, size_t count, size_t n, size_t begin = 0)
+            {
+                typedef Accumulator<TRing> TAccumulator;
+                size_t const capacity = TAccumulator::Capacity() - 1;
+                for (size_t i = begin; i != n; ++i)
+                {
+                    TAccumulator sum(dst[i]);
+                    for (size_t t = 0, left = capacity; t != count; ++t, --left)
+                    {
+                        if (!left)
+                        {
+                            sum = TAccumulator(sum.Result());
+                            left = capacity - 1;
+                        }
+                        sum.AddProduct(coefficients[t], sources[t][i]);
+                    }
+                    dst[i] = sum.Result();
+                }
+            }
+            static void AddRows(TRing *dst, TRing const *const *sources,
+                size_t count, size_t n, size_t begin = 0)
+            {
+                typedef Accumulator<TRing> TAccumulator;
+                size_t const capacity = TAccumulator::Capacity() - 1;
+                for (size_t i = begin; i != n; ++i)
+                {
+                    TAccumulator sum(dst[i]);
+                    for (size_t t = 0, left = capacity; t != count; ++t, --left)
+                    {
+                        if (!left)
+                        {
+                            sum = TAccumulator(sum.Result());
+                            left = capacity - 1;
+                        }
+                        sum.Add(sources[t][i]);
+                    }
+                    dst[i] = sum.Result();
+                }
+            }
+            template <typename TColumn>
+            static void AddSparseProducts(TRing *dst, unsigned char const *mask,
+                TColumn const *columns, TRing const *values, size_t D, TRing const *x, size_t n)
+            {
+                typedef Accumulator<TRing> TAccumulator;
+                size_t const capacity = TAccumulator::Capacity() - 1;
+                for (size_t i = 0; i != n; ++i)
+                {
+                    if (!mask[i])
+                        continue;
+                    size_t const r = i % SparseBlockRows;
+                    size_t const first = (i - r) * D + r;
+                    TAccumulator sum(dst[i]);
+                    for (size_t t = 0, left = capacity; t != D; ++t, --left)
+                    {
+                        if (!left)
+                        {
+                            sum = TAccumulator(sum.Result());
+                            left = capacity - 1;
+                        }
+                        size_t const e = first + t * SparseBlockRows;
+                        sum.AddProduct(values[e], x[columns[e]]);
+                    }
+                    dst[i] = sum.Result();
+                }
+            }
+            template <typename TIndex>
+            static void AddSparseSums(TRing *dst, unsigned char const *mask,
+                TIndex const *indices, uint32_t const *degrees, TRing const *x, size_t blocks)
+            {
+                typedef Accumulator<TRing> TAccumulator;
+                size_t const capacity = TAccumulator::Capacity() - 1;
+                for (size_t b = 0; b != blocks; ++b)
+                {
+                    size_t const degree = degrees[b];
+                    for (size_t r = 0; r != SparseBlockRows; ++r)
+                    {
+                        if (!mask[r])
+                            continue;
+                        TAccumulator sum(dst[r]);
+                        for (size_t t = 0, left = capacity; t != degree; ++t)
+                        {
+                            TIndex const index = indices[t * SparseBlockRows + r];
+                            if (index == (TIndex)-1)
+                                continue;
+                            if (!left)
+                            {
+                                sum = TAccumulator(sum.Result());
+                                left = capacity - 1;
+                            }
+                            sum.Add(x[index]);
+                            --left;
+                        }
+                        dst[r] = sum.Result();
+                    }
+                    dst += SparseBlockRows;
+                    mask += SparseBlockRows;
+                    indices += degree * SparseBlockRows;
+                }
+            }
+        };
+
+#ifdef FIELD_KERNELS_X86_
+
+        /* Each function processes the largest multiple of 8 elements
+         * and returns that number; the caller finishes the tail.
+         * dst may coincide with any source (but not overlap partially).
+         */
+        template <uint32_t p>
+        struct Avx2
+        {
+            static constexpr uint64_t C = ((uint64_t)0 - p) & 0xFFFFFFFFu;
+
+            static FIELD_KERNELS_AVX2_ __m256i AddV(__m256i a, __m256i b)
+            {
+                /* a+b-p if a>=p-b, otherwise a+b, both modulo 2^32 */
+                __m256i const pb = _mm256_sub_epi32(_mm256_set1_epi32((int)p), b);
+                __m256i const ge = _mm256_cmpeq_epi32(_mm256_max_epu32(a, pb), a);
+                return _mm256_blendv_epi8(_mm256_add_epi32(a, b), _mm256_sub_epi32(a, pb), ge);
+            }
+            static FIELD_KERNELS_AVX2_ __m256i SubtractV(__m256i a, __m256i b)
+            {
+                __m256i const d = _mm256_sub_epi32(a, b);
+                __m256i const ge = _mm256_cmpeq_epi32(_mm256_max_epu32(a, b), a);
+                return _mm256_blendv_epi8(_mm256_add_epi32(d, _mm256_set1_epi32((int)p)), d, ge);
+            }
+            static FIELD_KERNELS_AVX2_ __m256i NegateV(__m256i a)
+            {
+                __m256i const zero = _mm256_cmpeq_epi32(a, _mm256_setzero_si256());
+                return _mm256_andnot_si256(zero, _mm256_sub_epi32(_mm256_set1_epi32((int)p), a));
+            }
+            /* Reduces four 64-bit lanes, see ReductionImpl_::Reducer. */
+            static FIELD_KERNELS_AVX2_ __m256i Reduce64(__m256i x)
+            {
+                __m256i const c = _mm256_set1_epi64x((long long)C);
+                __m256i const low = _mm256_set1_epi64x(0xFFFFFFFFll);
+                x = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(x, 32), c), _mm256_and_si256(x, low));
+                x = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(x, 32), c), _mm256_and_si256(x, low));
+                /* x < 2p < 2^63, signed comparison suffices */
+                __m256i const ge = _mm256_cmpgt_epi64(x, _mm256_set1_epi64x((long long)p - 1));
+                return _mm256_sub_epi64(x, _mm256_and_si256(ge, _mm256_set1_epi64x((long long)p)));
+            }
+            static FIELD_KERNELS_AVX2_ __m256i MultiplyV(__m256i a, __m256i b)
+            {
+                __m256i const even = Reduce64(_mm256_mul_epu32(a, b));
+                __m256i const odd = Reduce64(_mm256_mul_epu32(
+                    _mm256_srli_epi64(a, 32), _mm256_srli_epi64(b, 32)));
+                return _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xAA);
+            }
+            static FIELD_KERNELS_AVX2_ __m256i Load(uint32_t const *x)
+            {
+                return _mm256_loadu_si256((__m256i const *)x);
+            }
+            static FIELD_KERNELS_AVX2_ void Store(uint32_t *x, __m256i v)
+            {
+                _mm256_storeu_si256((__m256i *)x, v);
+            }
+
+            static FIELD_KERNELS_AVX2_ size_t Add(uint32_t *dst, uint32_t const *a, uint32_t const *b, size_t n)
+            {
+                size_t i = 0;
+                for (; i + 8 <= n; i += 8)
+                    Store(dst + i, AddV(Load(a + i), Load(b + i)));
+                return i;
+            }
+            static FIELD_KERNELS_AVX2_ size_t Subtract(uint32_t *dst, uint32_t const *a, uint32_t const *b, size_t n)
+            {
+                size_t i = 0;
+                for (; i + 8 <= n; i += 8)
+                    Store(dst + i, SubtractV(Load(a + i), Load(b + i)));
+                return i;
+            }
+            static FIELD_KERNELS_AVX2_ size_t Negate(uint32_t *dst, uint32_t const *a, size_t n)
+            {
+                size_t i = 0;
+                for (; i + 8 <= n; i += 8)
+                    Store(dst + i, NegateV(Load(a + i)));
+                return i;
+            }
+            static FIELD_KERNELS_AVX2_ size_t Scale(uint32_t *dst, uint32_t const *a, uint32_t s, size_t n)
+            {
+                __m256i const sv = _mm256_set1_epi32((int)s);
+                size_t i = 0;
+                for (; i + 8 <= n; i += 8)
+                    Store(dst + i, MultiplyV(Load(a + i), sv));
+                return i;
+            }
+            static FIELD_KERNELS_AVX2_ size_t Axpy(uint32_t *dst, uint32_t s, uint32_t const *x, size_t n)
+            {
+                __m256i const sv = _mm256_set1_epi32((int)s);
+                size_t i = 0;
+                for (; i + 8 <= n; i += 8)
+                    Store(dst + i, AddV(Load(dst + i), MultiplyV(sv, Load(x + i))));
+                return i;
+            }
+            static FIELD_KERNELS_AVX2_ size_t MultiplyAdd(uint32_t *dst, uint32_t const *a, uint32_t const *b, uint32_t const *c, size_t n)
+            {
+                size_t i = 0;
+                for (; i + 8 <= n; i += 8)
+                    Store(dst + i, AddV(MultiplyV(Load(a + i), Load(b + i)), Load(c + i)));
+                return i;
+            }
+            /* The products are folded once and summed in 64-bit lanes,
+             * so count must not exceed MaxTerms(). */
+            static FIELD_KERNELS_AVX2_ size_t SubtractCombination(uint32_t *dst, uint32_t const *coefficients,
+                uint32_t const *sources, size_t stride, size_t count, size_t n)
+            {
+                __m256i const c = _mm256_set1_epi64x((long long)C);
+                __m256i const low = _mm256_set1_epi64x(0xFFFFFFFFll);
+                size_t i = 0;
+                for (; i + 8 <= n; i += 8)
+                {
+                    __m256i even = _mm256_setzero_si256(), odd = _mm256_setzero_si256();
+                    for (size_t t = 0; t != count; ++t)
+                    {
+                        __m256i const s = _mm256_set1_epi32((int)coefficients[t]);
+                        __m256i const x = Load(sources + t * stride + i);
+                        __m256i const pe = _mm256_mul_epu32(x, s);
+                        __m256i const po = _mm256_mul_epu32(_mm256_srli_epi64(x, 32), s);
+                        even = _mm256_add_epi64(even, _mm256_add_epi64(
+                            _mm256_mul_epu32(_mm256_srli_epi64(pe, 32), c), _mm256_and_si256(pe, low)));
+                        odd = _mm256_add_epi64(odd, _mm256_add_epi64(
+                            _mm256_mul_epu32(_mm256_srli_epi64(po, 32), c), _mm256_and_si256(po, low)));
+                    }
+                    __m256i const sum = _mm256_blend_epi32(Reduce64(even),
+                        _mm256_slli_epi64(Reduce64(odd), 32), 0xAA);
+                    Store(dst + i, SubtractV(Load(dst + i), sum));
+                }
+                return i;
+            }
+            /* Lanes [0, left) of a partial vector. */
+            static FIELD_KERNELS_AVX2_ __m256i TailMask(size_t left)
+            {
+                return _mm256_cmpgt_epi32(_mm256_set1_epi32((int)(left < 8 ? left : 8)),
+                    _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+            }
+            /* Same as SubtractCombination, with sources[t] for the rows
+             * and adding; count must not exceed MaxTerms(). The rows are
+             * short (one element per instance), so the tail is masked and
+             * all the n elements are done. */
+            static FIELD_KERNELS_AVX2_ size_t AddCombinationOfRows(uint32_t *dst, uint32_t const *coefficients,
+                uint32_t const *const *sources, size_t count, size_t n)
+            {
+                __m256i const c = _mm256_set1_epi64x((long long)C);
+                __m256i const low = _mm256_set1_epi64x(0xFFFFFFFFll);
+                for (size_t i = 0; i < n; i += 8)
+                {
+                    __m256i const m = TailMask(n - i);
+                    __m256i even = _mm256_setzero_si256(), odd = _mm256_setzero_si256();
+                    for (size_t t = 0; t != count; ++t)
+                    {
+                        __m256i const s = _mm256_set1_epi32((int)coefficients[t]);
+                        __m256i const x = _mm256_maskload_epi32((int const *)(sources[t] + i), m);
+                        __m256i const pe = _mm256_mul_epu32(x, s);
+                        __m256i const po = _mm256_mul_epu32(_mm256_srli_epi64(x, 32), s);
+                        even = _mm256_add_epi64(even, _mm256_add_epi64(
+                            _mm256_mul_epu32(_mm256_srli_epi64(pe, 32), c), _mm256_and_si256(pe, low)));
+                        odd = _mm256_add_epi64(odd, _mm256_add_epi64(
+                            _mm256_mul_epu32(_mm256_srli_epi64(po, 32), c), _mm256_and_si256(po, low)));
+                    }
+                    __m256i const sum = _mm256_blend_epi32(Reduce64(even),
+                        _mm256_slli_epi64(Reduce64(odd), 32), 0xAA);
+                    _mm256_maskstore_epi32((int *)(dst + i), m,
+                        AddV(_mm256_maskload_epi32((int const *)(dst + i), m), sum));
+                }
+                return n;
+            }
+            static FIELD_KERNELS_AVX2_ size_t AddRows(uint32_t *dst, uint32_t const *const *sources,
+                size_t count, size_t n)
+            {
+                for (size_t i = 0; i < n; i += 8)
+                {
+                    __m256i const m = TailMask(n - i);
+                    __m256i sum = _mm256_maskload_epi32((int const *)(dst + i), m);
+                    for (size_t t = 0; t != count; ++t)
+                        sum = AddV(sum, _mm256_maskload_epi32((int const *)(sources[t] + i), m));
+                    _mm256_maskstore_epi32((int *)(dst + i), m, sum);
+                }
+                return n;
+            }
+            static constexpr size_t MaxTerms()
+            {
+                return (size_t)(((uint64_t)0 - 1) / ((C + 1) << 32));
+            }
+            static FIELD_KERNELS_AVX2_ __m256i LoadColumns(uint16_t const *x)
+            {
+                return _mm256_cvtepu16_epi32(_mm_loadu_si128((__m128i const *)x));
+            }
+            static FIELD_KERNELS_AVX2_ __m256i LoadColumns(uint32_t const *x)
+            {
+                return Load(x);
+            }
+            /* Processes whole blocks of SparseBlockRows rows, 8 rows at a
+             * time, gathering the inputs. The inputs of the rows whose mask
+             * is zero are gathered as zero, so these rows add zero instead
+             * of being branched around. */
+            template <typename TColumn>
+            static FIELD_KERNELS_AVX2_ size_t AddSparseProducts(uint32_t *dst, unsigned char const *mask,
+                TColumn const *columns, uint32_t const *values, size_t D, uint32_t const *x, size_t n)
+            {
+                if (D > MaxTerms())
+                    return 0;
+                __m256i const c = _mm256_set1_epi64x((long long)C);
+                __m256i const low = _mm256_set1_epi64x(0xFFFFFFFFll);
+                __m256i const zero = _mm256_setzero_si256();
+                size_t i = 0;
+                for (; i + SparseBlockRows <= n; i += SparseBlockRows,
+                    columns += SparseBlockRows * D, values += SparseBlockRows * D)
+                    for (size_t h = 0; h != SparseBlockRows; h += 8)
+                    {
+                        __m256i const m = _mm256_cmpgt_epi32(_mm256_cvtepu8_epi32(
+                            _mm_loadl_epi64((__m128i const *)(mask + i + h))), zero);
+                        if (_mm256_testz_si256(m, m))
+                            continue;
+                        __m256i even = zero, odd = zero;
+                        for (size_t t = 0; t != D; ++t)
+                        {
+                            size_t const e = t * SparseBlockRows + h;
+                            __m256i const xv = _mm256_mask_i32gather_epi32(zero,
+                                (int const *)x, LoadColumns(columns + e), m, 4);
+                            __m256i const v = Load(values + e);
+                            __m256i const pe = _mm256_mul_epu32(xv, v);
+                            __m256i const po = _mm256_mul_epu32(_mm256_srli_epi64(xv, 32), _mm256_srli_epi64(v, 32));
+                            even = _mm256_add_epi64(even, _mm256_add_epi64(
+                                _mm256_mul_epu32(_mm256_srli_epi64(pe, 32), c), _mm256_and_si256(pe, low)));
+                            odd = _mm256_add_epi64(odd, _mm256_add_epi64(
+                                _mm256_mul_epu32(_mm256_srli_epi64(po, 32), c), _mm256_and_si256(po, low)));
+                        }
+                        __m256i const sum = _mm256_blend_epi32(Reduce64(even),
+                            _mm256_slli_epi64(Reduce64(odd), 32), 0xAA);
+                        Store(dst + i + h, AddV(Load(dst + i + h), sum));
+                    }
+                return i;
+            }
+            /* Each block as two vectors of 8 rows; the indices equal to
+             * (TIndex)-1 and the rows whose mask is zero gather zero. */
+            template <typename TIndex>
+            static FIELD_KERNELS_AVX2_ size_t AddSparseSums(uint32_t *dst, unsigned char const *mask,
+                TIndex const *indices, uint32_t const *degrees, uint32_t const *x, size_t blocks)
+            {
+                __m256i const zero = _mm256_setzero_si256();
+                __m256i const none = _mm256_set1_epi32((int)(uint32_t)(TIndex)-1);
+                for (size_t b = 0; b != blocks; ++b)
+                {
+                    size_t const degree = degrees[b];
+                    for (size_t h = 0; h != SparseBlockRows; h += 8)
+                    {
+                        __m256i const m = _mm256_cmpgt_epi32(_mm256_cvtepu8_epi32(
+                            _mm_loadl_epi64((__m128i const *)(mask + h))), zero);
+                        if (_mm256_testz_si256(m, m))
+                            continue;
+                        __m256i sum = zero;
+                        for (size_t t = 0; t != degree; ++t)
+                        {
+                            __m256i const index = LoadColumns(indices + t * SparseBlockRows + h);
+                            __m256i const present = _mm256_andnot_si256(_mm256_cmpeq_epi32(index, none), m);
+                            sum = AddV(sum, _mm256_mask_i32gather_epi32(zero, (int const *)x, index, present, 4));
+                        }
+                        Store(dst + h, AddV(Load(dst + h), sum));
+                    }
+                    dst += SparseBlockRows;
+                    mask += SparseBlockRows;
+                    indices += degree * SparseBlockRows;
+                }
+                return blocks;
+            }
+        };
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+/* the AVX-512 intrinsics trip -Wmaybe-uninitialized in some GCC headers */
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+        /* Same as Avx2, processing multiples of 16 elements. */
+        template <uint32_t p>
+        struct Avx512
+        {
+            static constexpr uint64_t C = ((uint64_t)0 - p) & 0xFFFFFFFFu;
+
+            static FIELD_KERNELS_AVX512_ __m512i AddV(__m512i a, __m512i b)
+            {
+                __m512i const pb = _mm512_sub_epi32(_mm512_set1_epi32((int)p), b);
+                __mmask16 const ge = _mm512_cmpge_epu32_mask(a, pb);
+                return _mm512_mask_sub_epi32(_mm512_add_epi32(a, b), ge, a, pb);
+            }
+            static FIELD_KERNELS_AVX512_ __m512i SubtractV(__m512i a, __m512i b)
+            {
+                __m512i const d = _mm512_sub_epi32(a, b);
+                __mmask16 const lt = _mm512_cmplt_epu32_mask(a, b);
+                return _mm512_mask_add_epi32(d, lt, d, _mm512_set1_epi32((int)p));
+            }
+            static FIELD_KERNELS_AVX512_ __m512i NegateV(__m512i a)
+            {
+                __mmask16 const nonzero = _mm512_test_epi32_mask(a, a);
+                return _mm512_maskz_sub_epi32(nonzero, _mm512_set1_epi32((int)p), a);
+            }
+            static FIELD_KERNELS_AVX512_ __m512i Reduce64(__m512i x)
+            {
+                __m512i const c = _mm512_set1_epi64((long long)C);
+                __m512i const low = _mm512_set1_epi64(0xFFFFFFFFll);
+                __m512i const pv = _mm512_set1_epi64((long long)p);
+                x = _mm512_add_epi64(_mm512_mul_epu32(_mm512_srli_epi64(x, 32), c), _mm512_and_si512(x, low));
+                x = _mm512_add_epi64(_mm512_mul_epu32(_mm512_srli_epi64(x, 32), c), _mm512_and_si512(x, low));
+                return _mm512_mask_sub_epi64(x, _mm512_cmpge_epu64_mask(x, pv), x, pv);
+            }
+            static FIELD_KERNELS_AVX512_ __m512i MultiplyV(__m512i a, __m512i b)
+            {
+                __m512i const even = Reduce64(_mm512_mul_epu32(a, b));
+                __m512i const odd = Reduce64(_mm512_mul_epu32(
+                    _mm512_srli_epi64(a, 32), _mm512_srli_epi64(b, 32)));
+                return _mm512_mask_blend_epi32(0xAAAA, even, _mm512_slli_epi64(odd, 32));
+            }
+            static FIELD_KERNELS_AVX512_ __m512i Load(uint32_t const *x)
+            {
+                return _mm512_loadu_si512((void const *)x);
+            }
+            static FIELD_KERNELS_AVX512_ void Store(uint32_t *x, __m512i v)
+            {
+                _mm512_storeu_si512((void *)x, v);
+            }
+
+            static FIELD_KERNELS_AVX512_ size_t Add(uint32_t *dst, uint32_t const *a, uint32_t const *b, size_t n)
+            {
+                size_t i = 0;
+                for (; i + 16 <= n; i += 16)
+                    Store(dst + i, AddV(Load(a + i), Load(b + i)));
+                return i;
+            }
+            static FIELD_KERNELS_AVX512_ size_t Subtract(uint32_t *dst, uint32_t const *a, uint32_t const *b, size_t n)
+            {
+                size_t i = 0;
+                for (; i + 16 <= n; i += 16)
+                    Store(dst + i, SubtractV(Load(a + i), Load(b + i)));
+                return i;
+            }
+            static FIELD_KERNELS_AVX512_ size_t Negate(uint32_t *dst, uint32_t const *a, size_t n)
+            {
+                size_t i = 0;
+                for (; i + 16 <= n; i += 16)
+                    Store(dst + i, NegateV(Load(a + i)));
+                return i;
+            }
+            static FIELD_KERNELS_AVX512_ size_t Scale(uint32_t *dst, uint32_t const *a, uint32_t s, size_t n)
+            {
+                __m512i const sv = _mm512_set1_epi32((int)s);
+                size_t i = 0;
+                for (; i + 16 <= n; i += 16)
+                    Store(dst + i, MultiplyV(Load(a + i), sv));
+                return i;
+            }
+            static FIELD_KERNELS_AVX512_ size_t Axpy(uint32_t *dst, uint32_t s, uint32_t const *x, size_t n)
+            {
+                __m512i const sv = _mm512_set1_epi32((int)s);
+                size_t i = 0;
+                for (; i + 16 <= n; i += 16)
+                    Store(dst + i, AddV(Load(dst + i), MultiplyV(sv, Load(x + i))));
+                return i;
+            }
+            static FIELD_KERNELS_AVX512_ size_t MultiplyAdd(uint32_t *dst, uint32_t const *a, uint32_t const *b, uint32_t const *c, size_t n)
+            {
+                size_t i = 0;
+                for (; i + 16 <= n; i += 16)
+                    Store(dst + i, AddV(MultiplyV(Load(a + i), Load(b + i)), Load(c + i)));
+                return i;
+            }
+            static FIELD_KERNELS_AVX512_ size_t SubtractCombination(uint32_t *dst, uint32_t const *coefficients,
+                uint32_t const *sources, size_t stride, size_t count, size_t n)
+            {
+                __m512i const c = _mm512_set1_epi64((long long)C);
+                __m512i const low = _mm512_set1_epi64(0xFFFFFFFFll);
+                size_t i = 0;
+                for (; i + 16 <= n; i += 16)
+                {
+                    __m512i even = _mm512_setzero_si512(), odd = _mm512_setzero_si512();
+                    for (size_t t = 0; t != count; ++t)
+                    {
+                        __m512i const s = _mm512_set1_epi32((int)coefficients[t]);
+                        __m512i const x = Load(sources + t * stride + i);
+                        __m512i const pe = _mm512_mul_epu32(x, s);
+                        __m512i const po = _mm512_mul_epu32(_mm512_srli_epi64(x, 32), s);
+                        even = _mm512_add_epi64(even, _mm512_add_epi64(
+                            _mm512_mul_epu32(_mm512_srli_epi64(pe, 32), c), _mm512_and_si512(pe, low)));
+                        odd = _mm512_add_epi64(odd, _mm512_add_epi64(
+                            _mm512_mul_epu32(_mm512_srli_epi64(po, 32), c), _mm512_and_si512(po, low)));
+                    }
+                    __m512i const sum = _mm512_mask_blend_epi32(0xAAAA, Reduce64(even),
+                        _mm512_slli_epi64(Reduce64(odd), 32));
+                    Store(dst + i, SubtractV(Load(dst + i), sum));
+                }
+                return i;
+            }
+            static FIELD_KERNELS_AVX512_ __mmask16 TailMask(size_t left)
+            {
+                return left < 16 ? (__mmask16)((1u << left) - 1) : (__mmask16)0xFFFF;
+            }
+            /* See Avx2::AddCombinationOfRows. */
+            static FIELD_KERNELS_AVX512_ size_t AddCombinationOfRows(uint32_t *dst, uint32_t const *coefficients,
+                uint32_t const *const *sources, size_t count, size_t n)
+            {
+                __m512i const c = _mm512_set1_epi64((long long)C);
+                __m512i const low = _mm512_set1_epi64(0xFFFFFFFFll);
+                for (size_t i = 0; i < n; i += 16)
+                {
+                    __mmask16 const m = TailMask(n - i);
+                    __m512i even = _mm512_setzero_si512(), odd = _mm512_setzero_si512();
+                    for (size_t t = 0; t != count; ++t)
+                    {
+                        __m512i const s = _mm512_set1_epi32((int)coefficients[t]);
+                        __m512i const x = _mm512_maskz_loadu_epi32(m, sources[t] + i);
+                        __m512i const pe = _mm512_mul_epu32(x, s);
+                        __m512i const po = _mm512_mul_epu32(_mm512_srli_epi64(x, 32), s);
+                        even = _mm512_add_epi64(even, _mm512_add_epi64(
+                            _mm512_mul_epu32(_mm512_srli_epi64(pe, 32), c), _mm512_and_si512(pe, low)));
+                        odd = _mm512_add_epi64(odd, _mm512_add_epi64(
+                            _mm512_mul_epu32(_mm512_srli_epi64(po, 32), c), _mm512_and_si512(po, low)));
+                    }
+                    __m512i const sum = _mm512_mask_blend_epi32(0xAAAA, Reduce64(even),
+                        _mm512_slli_epi64(Reduce64(odd), 32));
+                    _mm512_mask_storeu_epi32(dst + i, m,
+                        AddV(_mm512_maskz_loadu_epi32(m, dst + i), sum));
+                }
+                return n;
+            }
+            static FIELD_KERNELS_AVX512_ size_t AddRows(uint32_t *dst, uint32_t const *const *sources,
+                size_t count, size_t n)
+            {
+                for (size_t i = 0; i < n; i += 16)
+                {
+                    __mmask16 const m = TailMask(n - i);
+                    __m512i sum = _mm512_maskz_loadu_epi32(m, dst + i);
+                    for (size_t t = 0; t != count; ++t)
+                        sum = AddV(sum, _mm512_maskz_loadu_epi32(m, sources[t] + i));
+                    _mm512_mask_storeu_epi32(dst + i, m, sum);
+                }
+                return n;
+            }
+            static constexpr size_t MaxTerms()
+            {
+                return (size_t)(((uint64_t)0 - 1) / ((C + 1) << 32));
+            }
+            static FIELD_KERNELS_AVX512_ __m512i LoadColumns(uint16_t const *x)
+            {
+                return _mm512_cvtepu16_epi32(_mm256_loadu_si256((__m256i const *)x));
+            }
+            static FIELD_KERNELS_AVX512_ __m512i LoadColumns(uint32_t const *x)
+            {
+                return Load(x);
+            }
+            /* A block of SparseBlockRows rows at a time. */
+            template <typename TColumn>
+            static FIELD_KERNELS_AVX512_ size_t AddSparseProducts(uint32_t *dst, unsigned char const *mask,
+                TColumn const *columns, uint32_t const *values, size_t D, uint32_t const *x, size_t n)
+            {
+                static_assert(SparseBlockRows == 16, "A block must fill a vector.");
+                if (D > MaxTerms())
+                    return 0;
+                __m512i const c = _mm512_set1_epi64((long long)C);
+                __m512i const low = _mm512_set1_epi64(0xFFFFFFFFll);
+                __m512i const zero = _mm512_setzero_si512();
+                size_t i = 0;
+                for (; i + 16 <= n; i += 16, columns += 16 * D, values += 16 * D)
+                {
+                    __m512i const bytes = _mm512_cvtepu8_epi32(_mm_loadu_si128((__m128i const *)(mask + i)));
+                    __mmask16 const m = _mm512_test_epi32_mask(bytes, bytes);
+                    if (!m)
+                        continue;
+                    __m512i even = zero, odd = zero;
+                    for (size_t t = 0; t != D; ++t)
+                    {
+                        __m512i const xv = _mm512_mask_i32gather_epi32(zero, m,
+                            LoadColumns(columns + t * 16), (void const *)x, 4);
+                        __m512i const v = Load(values + t * 16);
+                        __m512i const pe = _mm512_mul_epu32(xv, v);
+                        __m512i const po = _mm512_mul_epu32(_mm512_srli_epi64(xv, 32), _mm512_srli_epi64(v, 32));
+                        even = _mm512_add_epi64(even, _mm512_add_epi64(
+                            _mm512_mul_epu32(_mm512_srli_epi64(pe, 32), c), _mm512_and_si512(pe, low)));
+                        odd = _mm512_add_epi64(odd, _mm512_add_epi64(
+                            _mm512_mul_epu32(_mm512_srli_epi64(po, 32), c), _mm512_and_si512(po, low)));
+                    }
+                    __m512i const sum = _mm512_mask_blend_epi32(0xAAAA, Reduce64(even),
+                        _mm512_slli_epi64(Reduce64(odd), 32));
+                    Store(dst + i, AddV(Load(dst + i), sum));
+                }
+                return i;
+            }
+            template <typename TIndex>
+            static FIELD_KERNELS_AVX512_ size_t AddSparseSums(uint32_t *dst, unsigned char const *mask,
+                TIndex const *indices, uint32_t const *degrees, uint32_t const *x, size_t blocks)
+            {
+                __m512i const zero = _mm512_setzero_si512();
+                __m512i const none = _mm512_set1_epi32((int)(uint32_t)(TIndex)-1);
+                for (size_t b = 0; b != blocks; ++b)
+                {
+                    size_t const degree = degrees[b];
+                    __m512i const bytes = _mm512_cvtepu8_epi32(_mm_loadu_si128((__m128i const *)mask));
+                    __mmask16 const m = _mm512_test_epi32_mask(bytes, bytes);
+                    if (m)
+                    {
+                        __m512i sum = zero;
+                        for (size_t t = 0; t != degree; ++t)
+                        {
+                            __m512i const index = LoadColumns(indices + t * 16);
+                            __mmask16 const present = _mm512_mask_cmpneq_epu32_mask(m, index, none);
+                            sum = AddV(sum, _mm512_mask_i32gather_epi32(zero, present, index, (void const *)x, 4));
+                        }
+                        Store(dst, AddV(Load(dst), sum));
+                    }
+                    dst += 16;
+                    mask += 16;
+                    indices += degree * 16;
+                }
+                return blocks;
+            }
+        };
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif // FIELD_KERNELS_X86_
+
+        /* Selects the vector path by instruction set and by
+         * whether TRing supports vectorised addition/multiplication.
+         */
+        template
+        <
+            typename TRing,
+            bool Additive = SimdTraits<TRing>::Additive,
+            bool Multiplicative = SimdTraits<TRing>::Multiplicative
+        >
+        struct Dispatcher : Scalar<TRing>
+        {
+        };
+
+#ifdef FIELD_KERNELS_X86_
+
+#define FIELD_KERNELS_RAW_(X) reinterpret_cast<uint32_t *>(X)
+#define FIELD_KERNELS_CRAW_(X) reinterpret_cast<uint32_t const *>(X)
+#define FIELD_KERNELS_DISPATCH_(NAME, ARGS) \
+    size_t done = 0; \
+    auto const isa = ActiveInstructionSet(); \
+    if (isa == InstructionSet::AVX512) \
+        done = Avx512<SimdTraits<TRing>::P>::NAME ARGS; \
+    else if (isa == InstructionSet::AVX2) \
+        done = Avx2<SimdTraits<TRing>::P>::NAME ARGS
+
+        template <typename TRing, bool Multiplicative>
+        struct Dispatcher<TRing, true, Multiplicative> : Scalar<TRing>
+        {
+            static_assert(sizeof(TRing) == sizeof(uint32_t), "TRing must be a bare uint32_t.");
+            static void Add(TRing *dst, TRing const *a, TRing const *b, size_t n)
+            {
+                FIELD_KERNELS_DISPATCH_(Add, (FIELD_KERNELS_RAW_(dst),
+                    FIELD_KERNELS_CRAW_(a), FIELD_KERNELS_CRAW_(b), n));
+                Scalar<TRing>::Add(dst + done, a + done, b + done, n - done);
+            }
+            static void Subtract(TRing *dst, TRing const *a, TRing const *b, size_t n)
+            {
+                FIELD_KERNELS_DISPATCH_(Subtract, (FIELD_KERNELS_RAW_(dst),
+                    FIELD_KERNELS_CRAW_(a), FIELD_KERNELS_CRAW_(b), n));
+                Scalar<TRing>::Subtract(dst + done, a + done, b + done, n - done);
+            }
+            static void Negate(TRing *dst, TRing const *a, size_t n)
+            {
+                FIELD_KERNELS_DISPATCH_(Negate, (FIELD_KERNELS_RAW_(dst),
+                    FIELD_KERNELS_CRAW_(a), n));
+                Scalar<TRing>::Negate(dst + done, a + done, n - done);
+            }
+            static void AddRows(TRing *dst, TRing const *const *sources, size_t count, size_t n)
+            {
+                FIELD_KERNELS_DISPATCH_(AddRows, (FIELD_KERNELS_RAW_(dst),
+                    reinterpret_cast<uint32_t const *const *>(sources), count, n));
+                Scalar<TRing>::AddRows(dst, sources, count, n, done);
+            }
+            /* only 16-bit and 32-bit indices are vectorised */
+            template <typename TIndex>
+            static void AddSparseSums(TRing *dst, unsigned char const *mask,
+                TIndex const *indices, uint32_t const *degrees, TRing const *x, size_t blocks)
+            {
+                Scalar<TRing>::AddSparseSums(dst, mask, indices, degrees, x, blocks);
+            }
+            static void AddSparseSums(TRing *dst, unsigned char const *mask,
+                uint16_t const *indices, uint32_t const *degrees, TRing const *x, size_t blocks)
+            {
+                VectorAddSparseSums(dst, mask, indices, degrees, x, blocks);
+            }
+            static void AddSparseSums(TRing *dst, unsigned char const *mask,
+                uint32_t const *indices, uint32_t const *degrees, TRing const *x, size_t blocks)
+            {
+                VectorAddSparseSums(dst, mask, indices, degrees, x, blocks);
+            }
+            template <typename TIndex>
+            static void VectorAddSparseSums(TRing *dst, unsigned char const *mask,
+                TIndex const *indices, uint32_t const *degrees, TRing const *x, size_t blocks)
+            {
+                FIELD_KERNELS_DISPATCH_(AddSparseSums, (FIELD_KERNELS_RAW_(dst), mask, indices,
+                    degrees, FIELD_KERNELS_CRAW_(x), blocks));
+                /* the vector paths process all the blocks */
+                if (!done)
+                    Scalar<TRing>::AddSparseSums(dst, mask, indices, degrees, x, blocks);
+            }
+        };
+
+        template <typename TRing>
+        struct Dispatcher<TRing, true, true> : Dispatcher<TRing, true, false>
+        {
+            static void Scale(TRing *dst, TRing const *a, TRing const s, size_t n)
+            {
+                FIELD_KERNELS_DISPATCH_(Scale, (FIELD_KERNELS_RAW_(dst),
+                    FIELD_KERNELS_CRAW_(a), (uint32_t)s, n));
+                Scalar<TRing>::Scale(dst + done, a + done, s, n - done);
+            }
+            static void Axpy(TRing *dst, TRing const s, TRing const *x, size_t n)
+            {
+                FIELD_KERNELS_DISPATCH_(Axpy, (FIELD_KERNELS_RAW_(dst),
+                    (uint32_t)s, FIELD_KERNELS_CRAW_(x), n));
+                Scalar<TRing>::Axpy(dst + done, s, x + done, n - done);
+            }
+            static void MultiplyAdd(TRing *dst, TRing const *a, TRing const *b, TRing const *c, size_t n)
+            {
+                FIELD_KERNELS_DISPATCH_(MultiplyAdd, (FIELD_KERNELS_RAW_(dst),
+                    FIELD_KERNELS_CRAW_(a), FIELD_KERNELS_CRAW_(b), FIELD_KERNELS_CRAW_(c), n));
+                Scalar<TRing>::MultiplyAdd(dst + done, a + done, b + done, c + done, n - done);
+            }
+            static void SubtractCombination(TRing *dst, TRing const *coefficients,
+                TRing const *sources, size_t stride, size_t count, size_t n)
+            {
+                /* both vector paths fold the same way */
+                size_t const maxTerms = Avx2<SimdTraits<TRing>::P>::MaxTerms();
+                for (; count > maxTerms; count -= maxTerms,
+                    coefficients += maxTerms, sources += maxTerms * stride)
+                    SubtractCombination(dst, coefficients, sources, stride, maxTerms, n);
+                FIELD_KERNELS_DISPATCH_(SubtractCombination, (FIELD_KERNELS_RAW_(dst),
+                    FIELD_KERNELS_CRAW_(coefficients), FIELD_KERNELS_CRAW_(sources), stride, count, n));
+                Scalar<TRing>::SubtractCombination(dst + done, coefficients,
+                    sources + done, stride, count, n - done);
+            }
+            static void AddCombinationOfRows(TRing *dst, TRing const *coefficients,
+                TRing const *const *sources, size_t count, size_t n)
+            {
+                size_t const maxTerms = Avx2<SimdTraits<TRing>::P>::MaxTerms();
+                for (; count > maxTerms; count -= maxTerms,
+                    coefficients += maxTerms, sources += maxTerms)
+                    AddCombinationOfRows(dst, coefficients, sources, maxTerms, n);
+                FIELD_KERNELS_DISPATCH_(AddCombinationOfRows, (FIELD_KERNELS_RAW_(dst),
+                    FIELD_KERNELS_CRAW_(coefficients),
+                    reinterpret_cast<uint32_t const *const *>(sources), count, n));
+                Scalar<TRing>::AddCombinationOfRows(dst, coefficients, sources, count, n, done);
+            }
+            /* only 16-bit and 32-bit columns are vectorised */
+            template <typename TColumn>
+            static void AddSparseProducts(TRing *dst, unsigned char const *mask,
+                TColumn const *columns, TRing const *values, size_t D, TRing const *x, size_t n)
+            {
+                Scalar<TRing>::AddSparseProducts(dst, mask, columns, values, D, x, n);
+            }
+            static void AddSparseProducts(TRing *dst, unsigned char const *mask,
+                uint16_t const *columns, TRing const *values, size_t D, TRing const *x, size_t n)
+            {
+                VectorAddSparseProducts(dst, mask, columns, values, D, x, n);
+            }
+            static void AddSparseProducts(TRing *dst, unsigned char const *mask,
+                uint32_t const *columns, TRing const *values, size_t D, TRing const *x, size_t n)
+            {
+                VectorAddSparseProducts(dst, mask, columns, values, D, x, n);
+            }
+            template <typename TColumn>
+            static void VectorAddSparseProducts(TRing *dst, unsigned char const *mask,
+                TColumn const *columns, TRing const *values, size_t D, TRing const *x, size_t n)
+            {
+                FIELD_KERNELS_DISPATCH_(AddSparseProducts, (FIELD_KERNELS_RAW_(dst), mask, columns,
+                    FIELD_KERNELS_CRAW_(values), D, FIELD_KERNELS_CRAW_(x), n));
+                /* done is a multiple of SparseBlockRows */
+                Scalar<TRing>::AddSparseProducts(dst + done, mask + done,
+                    columns + done * D, values + done * D, D, x, n - done);
+            }
+        };
+
+#undef FIELD_KERNELS_RAW_
+#undef FIELD_KERNELS_CRAW_
+#undef FIELD_KERNELS_DISPATCH_
+
+#endif // FIELD_KERNELS_X86_
+    }
+
+    /* Whether the additive kernels have a vector path for TRing
+     * with the active instruction set. */
+    template <typename TRing>
+    bool AdditionVectorised()
+    {
+        return FieldKernelsImpl_::SimdTraits<TRing>::Additive
+            && ActiveInstructionSet() != InstructionSet::Scalar;
+    }
+
+    /* dst[i] = a[i] + b[i] */
+    template <typename TRing>
+    void Add(TRing *dst, TRing const *a, TRing const *b, size_t n)
+    {
+        FieldKernelsImpl_::Dispatcher<TRing>::Add(dst, a, b, n);
+    }
+
+    /* dst[i] = a[i] - b[i] */
+    template <typename TRing>
+    void Subtract(TRing *dst, TRing const *a, TRing const *b, size_t n)
+    {
+        FieldKernelsImpl_::Dispatcher<TRing>::Subtract(dst, a, b, n);
+    }
+
+    /* dst[i] = -a[i] */
+    template <typename TRing>
+    void Negate(TRing *dst, TRing const *a, size_t n)
+    {
+        FieldKernelsImpl_::Dispatcher<TRing>::Negate(dst, a, n);
+    }
+
+    /* dst[i] = a[i] * s */
+    template <typename TRing>
+    void Scale(TRing *dst, TRing const *a, TRing const s, size_t n)
+    {
+        FieldKernelsImpl_::Dispatcher<TRing>::Scale(dst, a, s, n);
+    }
+
+    /* dst[i] += s * x[i] */
+    template <typename TRing>
+    void Axpy(TRing *dst, TRing const s, TRing const *x, size_t n)
+    {
+        FieldKernelsImpl_::Dispatcher<TRing>::Axpy(dst, s, x, n);
+    }
+
+    /* dst[i] = a[i] * b[i] + c[i] */
+    template <typename TRing>
+    void MultiplyAdd(TRing *dst, TRing const *a, TRing const *b, TRing const *c, size_t n)
+    {
+        FieldKernelsImpl_::Dispatcher<TRing>::MultiplyAdd(dst, a, b, c, n);
+    }
+
+    /* dst[i] -= sum of coefficients[t] * sources[t * stride + i] for t < count */
+    template <typename TRing>
+    void SubtractCombination(TRing *dst, TRing const *coefficients,
+        TRing const *sources, size_t stride, size_t count, size_t n)
+    {
+        FieldKernelsImpl_::Dispatcher<TRing>::SubtractCombination(
+            dst, coefficients, sources, stride, count, n);
+    }
+
+    /* dst[i] += sum of coefficients[t] * sources[t][i] for t < count */
+    template <typename TRing>
+    void AddCombinationOfRows(TRing *dst, TRing const *coefficients,
+        TRing const *const *sources, size_t count, size_t n)
+    {
+        FieldKernelsImpl_::Dispatcher<TRing>::AddCombinationOfRows(
+            dst, coefficients, sources, count, n);
+    }
+
+    /* dst[i] += sum of sources[t][i] for t < count */
+    template <typename TRing>
+    void AddRows(TRing *dst, TRing const *const *sources, size_t count, size_t n)
+    {
+        FieldKernelsImpl_::Dispatcher<TRing>::AddRows(dst, sources, count, n);
+    }
+
+    /* dst[i] += sum of the D products value * x[column] of the entries
+     * of row i (stored as described at SparseBlockRows), for each row
+     * i < n with mask[i] != 0. columns and values hold n * D entries,
+     * rounded up to whole blocks; columns must be less than 2^31. */
+    template <typename TRing, typename TColumn>
+    void AddSparseProducts(TRing *dst, unsigned char const *mask,
+        TColumn const *columns, TRing const *values, size_t D, TRing const *x, size_t n)
+    {
+        FieldKernelsImpl_::Dispatcher<TRing>::AddSparseProducts(
+            dst, mask, columns, values, D, x, n);
+    }
+
+    /* dst[i] += sum of x[index] over the indices of row i that are not
+     * (TIndex)-1, for each row i with mask[i] != 0, for the rows of
+     * blocks blocks; the rows of block b have degrees[b] indices each,
+     * stored like the entries of AddSparseProducts. Only needs addition;
+     * indices must be less than 2^31. */
+    template <typename TRing, typename TIndex>
+    void AddSparseSums(TRing *dst, unsigned char const *mask,
+        TIndex const *indices, uint32_t const *degrees, TRing const *x, size_t blocks)
+    {
+        FieldKernelsImpl_::Dispatcher<TRing>::AddSparseSums(
+            dst, mask, indices, degrees, x, blocks);
+    }
+}
+}
+
+#ifdef FIELD_KERNELS_X86_
+#undef FIELD_KERNELS_X86_
+#undef FIELD_KERNELS_AVX2_
+#undef FIELD_KERNELS_AVX512_
+#endif // FIELD_KERNELS_X86_
+
+#endif // FIELD_KERNELS_HPP_
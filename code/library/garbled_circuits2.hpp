@@ -3,9 +3,11 @@
 
 #include<cstdlib>
 #include<cstring>
+#include<algorithm>
 #include<vector>
 #include"cryptography.hpp"
 #include"arithmetic_circuits.hpp"
+#include"thread_pool.hpp"
 
 #define TPC_TYPENAMES_ \
     typename TCAllocGate, \
@@ -14,6 +16,10 @@
 #define CONF_TYPENAMES_ \
     typename TConfAllocSizeT
 
+#define PROG_TYPENAMES_ \
+    typename TProgAllocInstruction, \
+    typename TProgAllocSizeT
+
 #define KEYPAIRS_TYPENAMES_ \
     typename TKPRing, \
     typename TKPAllocRing, \
@@ -31,6 +37,10 @@
 #define CONF_TYPENAME_ARGS_ \
     TConfAllocSizeT
 
+#define PROG_TYPENAME_ARGS_ \
+    TProgAllocInstruction, \
+    TProgAllocSizeT
+
 #define KEYPAIRS_TYPENAME_ARGS_ \
     TKPRing, \
     TKPAllocRing, \
@@ -56,6 +66,7 @@ namespace Garbled2
 #include"./garbled_circuits2_impl/configure.hpp"
 #include"./garbled_circuits2_impl/garble.hpp"
 #include"./garbled_circuits2_impl/ungarble.hpp"
+#include"./garbled_circuits2_impl/program.hpp"
 
     }
 
@@ -125,16 +136,187 @@ namespace Garbled2
         > compile_(circuit, config, keys, outputIterator);
     }
 
+    template <TPC_TYPENAMES_, PROG_TYPENAMES_>
+    void Compile
+    (
+        TwoPartyCircuit<TPC_TYPENAME_ARGS_> &circuit,
+        Program<PROG_TYPENAME_ARGS_> &program
+    )
+    {
+        _CompilerImpl::CompileProgram
+        <
+            TPC_TYPENAME_ARGS_,
+            PROG_TYPENAME_ARGS_
+        > compile_(circuit, program);
+    }
+
+    template <PROG_TYPENAMES_, CONF_TYPENAMES_>
+    void Configure
+    (
+        Program<PROG_TYPENAME_ARGS_> const &program,
+        Configuration<CONF_TYPENAME_ARGS_> &config
+    )
+    {
+        _CompilerImpl::ConfigureProgram
+        <
+            PROG_TYPENAME_ARGS_,
+            CONF_TYPENAME_ARGS_
+        > compile_(program, config);
+    }
+
+    template
+    <
+        PROG_TYPENAMES_,
+        typename TKeyPairs,
+        typename TRandomGenerator,
+        typename TRingDistribution
+    >
+    void Garble
+    (
+        Program<PROG_TYPENAME_ARGS_> const &program,
+        size_t outputBegin, size_t outputEnd,
+        TKeyPairs &keypairs,
+        TRandomGenerator &next,
+        TRingDistribution &ringDist,
+        typename TKeyPairs::RingType const &one = 1,
+        typename TKeyPairs::RingType const &zero = 0
+    )
+    {
+        _CompilerImpl::GarbleProgram
+        <
+            PROG_TYPENAME_ARGS_,
+            TKeyPairs,
+            TRandomGenerator,
+            TRingDistribution
+        > compile_(program, outputBegin, outputEnd, keypairs, next, ringDist, one, zero);
+    }
+
+    template
+    <
+        PROG_TYPENAMES_,
+        typename TKeyPairs,
+        typename TRandomGenerator,
+        typename TRingDistribution
+    >
+    void Garble
+    (
+        Program<PROG_TYPENAME_ARGS_> const &program,
+        TKeyPairs &keypairs,
+        TRandomGenerator &next,
+        TRingDistribution &ringDist,
+        typename TKeyPairs::RingType const &one = 1,
+        typename TKeyPairs::RingType const &zero = 0
+    )
+    {
+        Garble(program, 0, program.OutputCount, keypairs, next, ringDist, one, zero);
+    }
+
+    /* Splits the outputs into at most pool.Size() + 1 ranges, garbled on
+     * pool and the calling thread; the i-th range draws from nexts[i] and
+     * its own copy of ringDist. */
+    template
+    <
+        PROG_TYPENAMES_,
+        typename TKeyPairs,
+        typename TRandomGenerator,
+        typename TRingDistribution
+    >
+    void ParallelGarble
+    (
+        Program<PROG_TYPENAME_ARGS_> const &program,
+        TKeyPairs &keypairs,
+        TRandomGenerator *nexts,
+        Concurrency::WorkStealingThreadPool &pool,
+        TRingDistribution const &ringDist,
+        typename TKeyPairs::RingType const &one = 1,
+        typename TKeyPairs::RingType const &zero = 0
+    )
+    {
+        auto const parts = _CompilerImpl::UsefulParts(program, pool.Size() + 1);
+        std::vector<TRingDistribution> dists(parts, ringDist);
+        pool.ParallelFor(parts, [&](size_t i)
+        {
+            auto const begin = _CompilerImpl::SplitOutputs(program, i, parts);
+            auto const end = _CompilerImpl::SplitOutputs(program, i + 1, parts);
+            Garble(program, begin, end, keypairs, nexts[i], dists[i], one, zero);
+        });
+    }
+
+    template
+    <
+        PROG_TYPENAMES_,
+        typename TKeys,
+        typename TOutputIt
+    >
+    void Ungarble
+    (
+        Program<PROG_TYPENAME_ARGS_> const &program,
+        size_t outputBegin, size_t outputEnd,
+        TKeys &keys,
+        TOutputIt outputIterator
+    )
+    {
+        _CompilerImpl::UngarbleProgram
+        <
+            PROG_TYPENAME_ARGS_,
+            TKeys
+        > compile_(program, outputBegin, outputEnd, keys, outputIterator);
+    }
+
+    template
+    <
+        PROG_TYPENAMES_,
+        typename TKeys,
+        typename TOutputIt
+    >
+    void Ungarble
+    (
+        Program<PROG_TYPENAME_ARGS_> const &program,
+        TKeys &keys,
+        TOutputIt outputIterator
+    )
+    {
+        Ungarble(program, 0, program.OutputCount, keys, outputIterator);
+    }
+
+    /* Splits the outputs like ParallelGarble, ungarbled on pool and the
+     * calling thread; the value of the i-th output goes to
+     * outputIterator[i]. */
+    template
+    <
+        PROG_TYPENAMES_,
+        typename TKeys,
+        typename TRandomAccessIt
+    >
+    void ParallelUngarble
+    (
+        Program<PROG_TYPENAME_ARGS_> const &program,
+        TKeys &keys,
+        TRandomAccessIt outputIterator,
+        Concurrency::WorkStealingThreadPool &pool
+    )
+    {
+        auto const parts = _CompilerImpl::UsefulParts(program, pool.Size() + 1);
+        pool.ParallelFor(parts, [&](size_t i)
+        {
+            auto const begin = _CompilerImpl::SplitOutputs(program, i, parts);
+            auto const end = _CompilerImpl::SplitOutputs(program, i + 1, parts);
+            Ungarble(program, begin, end, keys, outputIterator + begin);
+        });
+    }
+
 }
 }
 }
 
 #undef TPC_TYPENAMES_
 #undef CONF_TYPENAMES_
+#undef PROG_TYPENAMES_
 #undef KEYPAIRS_TYPENAMES_
 #undef KEYS_TYPENAMES_
 #undef TPC_TYPENAME_ARGS_
 #undef CONF_TYPENAME_ARGS_
+#undef PROG_TYPENAME_ARGS_
 #undef KEYPAIRS_TYPENAME_ARGS_
 #undef KEYS_TYPENAME_ARGS_
 
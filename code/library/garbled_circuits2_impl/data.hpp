@@ -22,6 +22,7 @@ template
 >
 struct KeyPairs
 {
+    typedef TRing RingType;
     typedef std::vector<TRing, TAllocRing> RingVec;
     typedef std::vector<RingVec, TAllocRingVec> RingVec2;
 
@@ -66,6 +67,7 @@ template
 >
 struct Keys
 {
+    typedef TRing RingType;
     typedef std::vector<TRing, TAllocRing> RingVec;
     typedef std::vector<RingVec, TAllocRingVec> RingVec2;
 
@@ -92,3 +94,135 @@ struct Keys
         }
     }
 };
+
+/* Prefix sums of the numbers of keys of the inputs of one role: the keys
+ * of the i-th input are [offset[i], offset[i + 1]) of a flat buffer. */
+template <typename TAllocSizeT, typename TAllocSizeTOffset>
+void ComputeKeyOffsets
+(
+    std::vector<size_t, TAllocSizeT> const &encoding,
+    std::vector<size_t, TAllocSizeTOffset> &offset
+)
+{
+    offset.resize(encoding.size() + 1);
+    offset[0] = 0;
+    for (size_t i = 0; i != encoding.size(); ++i)
+        offset[i + 1] = offset[i] + encoding[i];
+}
+
+/* KeyPairs with the keys of all inputs of a role in one buffer per
+ * field, addressed by AliceOffset and BobOffset. */
+template
+<
+    typename TRing,
+    typename TAllocRing = std::allocator<TRing>,
+    typename TAllocSizeT = std::allocator<size_t>
+>
+struct FlatKeyPairs
+{
+    typedef TRing RingType;
+    typedef std::vector<TRing, TAllocRing> RingVec;
+    typedef std::vector<size_t, TAllocSizeT> SizeTVec;
+
+    RingVec OfflineEncoding;
+    SizeTVec AliceOffset, BobOffset;
+    RingVec AliceCoefficient, AliceIntercept;
+    RingVec BobCoefficient, BobIntercept;
+
+    template <typename TAllocSizeTConf>
+    void ApplyConfiguration(Configuration<TAllocSizeTConf> const &config)
+    {
+        OfflineEncoding.clear();
+        OfflineEncoding.resize(config.OfflineEncoding);
+        ComputeKeyOffsets(config.AliceEncoding, AliceOffset);
+        ComputeKeyOffsets(config.BobEncoding, BobOffset);
+        for (auto vec : { &AliceCoefficient, &AliceIntercept })
+        {
+            vec->clear();
+            vec->resize(AliceOffset.back());
+        }
+        for (auto vec : { &BobCoefficient, &BobIntercept })
+        {
+            vec->clear();
+            vec->resize(BobOffset.back());
+        }
+    }
+};
+
+/* Keys with the keys of all inputs of a role in one buffer, addressed
+ * by AliceOffset and BobOffset. */
+template
+<
+    typename TRing,
+    typename TAllocRing = std::allocator<TRing>,
+    typename TAllocSizeT = std::allocator<size_t>
+>
+struct FlatKeys
+{
+    typedef TRing RingType;
+    typedef std::vector<TRing, TAllocRing> RingVec;
+    typedef std::vector<size_t, TAllocSizeT> SizeTVec;
+
+    RingVec OfflineEncoding;
+    SizeTVec AliceOffset, BobOffset;
+    RingVec AliceEncoding, BobEncoding;
+
+    template <typename TAllocSizeTConf>
+    void ApplyConfiguration(Configuration<TAllocSizeTConf> const &config)
+    {
+        OfflineEncoding.clear();
+        OfflineEncoding.resize(config.OfflineEncoding);
+        ComputeKeyOffsets(config.AliceEncoding, AliceOffset);
+        ComputeKeyOffsets(config.BobEncoding, BobOffset);
+        AliceEncoding.clear();
+        AliceEncoding.resize(AliceOffset.back());
+        BobEncoding.clear();
+        BobEncoding.resize(BobOffset.back());
+    }
+};
+
+namespace Operation
+{
+    typedef size_t Type;
+    constexpr Type ConstZero = 0;
+    constexpr Type ConstOne = 1;
+    constexpr Type ConstMinusOne = 2;
+    constexpr Type AliceInput = 3;
+    constexpr Type BobInput = 4;
+    constexpr Type Addition = 5;
+    constexpr Type Negation = 6;
+    constexpr Type Subtraction = 7;
+    constexpr Type Multiplication = 8;
+};
+
+/* One visit of a gate in the garbling. Inputs and constants carry the
+ * key slot they write to (Garble) or read from (Ungarble): Index is the
+ * major index of an input and Position the slot within it, and Offset is
+ * the slot among the keys of all inputs of the role, as laid out by
+ * FlatKeyPairs and FlatKeys. */
+struct Instruction
+{
+    Operation::Type Op;
+    size_t Index, Position, Offset;
+};
+
+template
+<
+    typename TAllocInstruction = std::allocator<Instruction>,
+    typename TAllocSizeT = std::allocator<size_t>
+>
+struct Program
+{
+    typedef std::vector<Instruction, TAllocInstruction> InstructionVec;
+    typedef std::vector<size_t, TAllocSizeT> SizeTVec;
+
+    /* the visits in the order of the recursive garbling */
+    InstructionVec Instructions;
+    /* the visits of the i-th output are the instructions in
+     * [OutputBegin[i], OutputBegin[i + 1]) */
+    SizeTVec OutputBegin;
+    size_t OutputCount;
+    size_t AliceInputCount, BobInputCount;
+    /* the stack sizes that Garble and Ungarble need for one output */
+    size_t GarbleDepth, UngarbleDepth;
+};
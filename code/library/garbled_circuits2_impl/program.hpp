@@ -0,0 +1,390 @@
+template <TPC_TYPENAMES_, PROG_TYPENAMES_>
+struct CompileProgram
+{
+    typedef TwoPartyCircuit<TPC_TYPENAME_ARGS_> TwoPartyCircuitType;
+    typedef Program<PROG_TYPENAME_ARGS_> ProgramType;
+
+    /* Expands the circuit in the order of the recursive garbling, one
+     * output at a time, with an explicit stack of the gates yet to visit.
+     * Each entry of the stack stands for a pair (k, b) that Garble will
+     * have on its own stack, so the largest size of it is the depth
+     * Garble needs. */
+    CompileProgram(
+        TwoPartyCircuitType &tpc,
+        ProgramType &program
+    )
+    {
+        Gate const *circuit = tpc.Gates.data();
+        std::vector<size_t> alice(tpc.AliceInputEnd - tpc.AliceInputBegin);
+        std::vector<size_t> bob(tpc.BobInputEnd - tpc.BobInputBegin);
+        std::vector<GateHandle> pending;
+        size_t offline = 0;
+        auto &code = program.Instructions;
+        code.clear();
+        program.OutputBegin.clear();
+        program.OutputCount = tpc.AliceOutput.size();
+        program.AliceInputCount = alice.size();
+        program.BobInputCount = bob.size();
+        program.GarbleDepth = 1;
+        for (auto const ao : tpc.AliceOutput)
+        {
+            program.OutputBegin.push_back(code.size());
+            pending.push_back(ao);
+            while (!pending.empty())
+            {
+                Gate const &g = circuit[pending.back()];
+                pending.pop_back();
+                Instruction ins;
+                ins.Index = 0;
+                ins.Position = 0;
+                ins.Offset = 0;
+                switch (g.Kind)
+                {
+                case GateKind::ConstZero:
+                    ins.Op = Operation::ConstZero;
+                    ins.Position = offline++;
+                    break;
+                case GateKind::ConstOne:
+                    ins.Op = Operation::ConstOne;
+                    ins.Position = offline++;
+                    break;
+                case GateKind::ConstMinusOne:
+                    ins.Op = Operation::ConstMinusOne;
+                    ins.Position = offline++;
+                    break;
+                case GateKind::InputGate:
+                    ins.Index = g.AsInputGate.MajorIndex;
+                    if (g.AsInputGate.Agent == AgentFlag::Alice)
+                    {
+                        ins.Op = Operation::AliceInput;
+                        ins.Position = alice[ins.Index]++;
+                    }
+                    else if (g.AsInputGate.Agent == AgentFlag::Bob)
+                    {
+                        ins.Op = Operation::BobInput;
+                        ins.Position = bob[ins.Index]++;
+                    }
+                    else
+                        std::exit(-99);
+                    break;
+                case GateKind::AdditionGate:
+                    ins.Op = Operation::Addition;
+                    pending.push_back(g.AsAdditionGate.Addend);
+                    pending.push_back(g.AsAdditionGate.Augend);
+                    break;
+                case GateKind::NegationGate:
+                    ins.Op = Operation::Negation;
+                    pending.push_back(g.AsNegationGate.Target);
+                    break;
+                case GateKind::SubtractionGate:
+                    ins.Op = Operation::Subtraction;
+                    pending.push_back(g.AsSubtractionGate.Subtrahend);
+                    pending.push_back(g.AsSubtractionGate.Minuend);
+                    break;
+                case GateKind::MultiplicationGate:
+                    ins.Op = Operation::Multiplication;
+                    pending.push_back(g.AsMultiplicationGate.Multiplicand);
+                    pending.push_back(g.AsMultiplicationGate.Multiplier);
+                    pending.push_back(g.AsMultiplicationGate.Multiplicand);
+                    pending.push_back(g.AsMultiplicationGate.Multiplier);
+                    break;
+                default:
+                    std::exit(-99);
+                }
+                code.push_back(ins);
+                if (pending.size() > program.GarbleDepth)
+                    program.GarbleDepth = pending.size();
+            }
+        }
+        program.OutputBegin.push_back(code.size());
+        std::vector<size_t> aliceOffset, bobOffset;
+        ComputeKeyOffsets(alice, aliceOffset);
+        ComputeKeyOffsets(bob, bobOffset);
+        for (auto &ins : code)
+        {
+            if (ins.Op == Operation::AliceInput)
+                ins.Offset = aliceOffset[ins.Index] + ins.Position;
+            else if (ins.Op == Operation::BobInput)
+                ins.Offset = bobOffset[ins.Index] + ins.Position;
+            else
+                ins.Offset = ins.Position;
+        }
+        /* Ungarble runs each output backwards: a leaf pushes one value,
+         * a gate pops the values of its visits and pushes its own. */
+        program.UngarbleDepth = 1;
+        for (size_t o = 0; o != program.OutputCount; ++o)
+        {
+            size_t depth = 0;
+            for (size_t i = program.OutputBegin[o + 1]; i-- != program.OutputBegin[o]; )
+            {
+                switch (code[i].Op)
+                {
+                case Operation::Addition:
+                case Operation::Subtraction:
+                    depth -= 1;
+                    break;
+                case Operation::Negation:
+                    break;
+                case Operation::Multiplication:
+                    depth -= 3;
+                    break;
+                default:
+                    ++depth;
+                    break;
+                }
+                if (depth > program.UngarbleDepth)
+                    program.UngarbleDepth = depth;
+            }
+        }
+    }
+};
+
+template <PROG_TYPENAMES_, CONF_TYPENAMES_>
+struct ConfigureProgram
+{
+    typedef Program<PROG_TYPENAME_ARGS_> ProgramType;
+    typedef Configuration<CONF_TYPENAME_ARGS_> ConfigurationType;
+
+    ConfigureProgram(
+        ProgramType const &program,
+        ConfigurationType &config
+    )
+    {
+        config.OfflineEncoding = 0;
+        config.AliceEncoding.assign(program.AliceInputCount, 0);
+        config.BobEncoding.assign(program.BobInputCount, 0);
+        for (auto const &ins : program.Instructions)
+        {
+            switch (ins.Op)
+            {
+            case Operation::ConstZero:
+            case Operation::ConstOne:
+            case Operation::ConstMinusOne:
+                ++config.OfflineEncoding;
+                break;
+            case Operation::AliceInput:
+                ++config.AliceEncoding[ins.Index];
+                break;
+            case Operation::BobInput:
+                ++config.BobEncoding[ins.Index];
+                break;
+            default:
+                break;
+            }
+        }
+    }
+};
+
+/* The key of an input instruction in the keys of its role, stored per
+ * input (KeyPairs and Keys) or in one buffer (FlatKeyPairs and FlatKeys). */
+template <typename TRing, typename TAllocRing, typename TAllocRingVec>
+TRing &KeySlot
+(
+    std::vector<std::vector<TRing, TAllocRing>, TAllocRingVec> &keys,
+    Instruction const &ins
+)
+{
+    return keys[ins.Index][ins.Position];
+}
+
+template <typename TRing, typename TAllocRing>
+TRing &KeySlot(std::vector<TRing, TAllocRing> &keys, Instruction const &ins)
+{
+    return keys[ins.Offset];
+}
+
+template
+<
+    PROG_TYPENAMES_, typename TKeyPairs,
+    typename TRandomGenerator, typename TRingDist
+>
+struct GarbleProgram
+{
+    typedef Program<PROG_TYPENAME_ARGS_> ProgramType;
+    typedef TKeyPairs KeyPairsType;
+    typedef typename TKeyPairs::RingType TKPRing;
+
+    /* Runs the instructions of the outputs [outputBegin, outputEnd)
+     * forwards. The top of the stack is the pair (k, b) handed to the
+     * current visit; the children of a gate are pushed in reverse so that
+     * the first is visited next. The random elements are drawn in the
+     * same order as the recursive Garble. */
+    GarbleProgram(
+        ProgramType const &program,
+        size_t outputBegin, size_t outputEnd,
+        KeyPairsType &keypairs,
+        TRandomGenerator &next,
+        TRingDist &ringDist,
+        TKPRing const &one,
+        TKPRing const &zero
+    )
+    {
+        std::vector<TKPRing> ks(program.GarbleDepth), bs(program.GarbleDepth);
+        auto const code = program.Instructions.data();
+        size_t top = 0;
+        for (size_t i = program.OutputBegin[outputBegin],
+            end = program.OutputBegin[outputEnd]; i != end; ++i)
+        {
+            auto const &ins = code[i];
+            /* a new output starts whenever the stack runs empty */
+            if (top == 0)
+            {
+                ks[0] = one;
+                bs[0] = zero;
+                top = 1;
+            }
+            --top;
+            TKPRing k = std::move(ks[top]);
+            TKPRing b = std::move(bs[top]);
+            switch (ins.Op)
+            {
+            case Operation::ConstZero:
+                keypairs.OfflineEncoding[ins.Position] = std::move(b);
+                break;
+            case Operation::ConstOne:
+                keypairs.OfflineEncoding[ins.Position] = k + b;
+                break;
+            case Operation::ConstMinusOne:
+                keypairs.OfflineEncoding[ins.Position] = b - k;
+                break;
+            case Operation::AliceInput:
+                KeySlot(keypairs.AliceCoefficient, ins) = std::move(k);
+                KeySlot(keypairs.AliceIntercept, ins) = std::move(b);
+                break;
+            case Operation::BobInput:
+                KeySlot(keypairs.BobCoefficient, ins) = std::move(k);
+                KeySlot(keypairs.BobIntercept, ins) = std::move(b);
+                break;
+            case Operation::Addition:
+            {
+                auto &&r = ringDist(next);
+                /* Addend */
+                ks[top] = k;
+                bs[top++] = b - r;
+                /* Augend */
+                ks[top] = std::move(k);
+                bs[top++] = std::move(r);
+                break;
+            }
+            case Operation::Negation:
+                ks[top] = -k;
+                bs[top++] = std::move(b);
+                break;
+            case Operation::Subtraction:
+            {
+                auto &&r = ringDist(next);
+                /* Subtrahend */
+                ks[top] = k;
+                bs[top++] = r;
+                /* Minuend */
+                ks[top] = std::move(k);
+                bs[top++] = b + r;
+                break;
+            }
+            case Operation::Multiplication:
+            {
+                auto &&r1 = ringDist(next);
+                auto &&r2 = ringDist(next);
+                auto &&r3 = ringDist(next);
+                b -= r1*r2 + r3;
+                /* Multiplicand, Multiplier, Multiplicand, Multiplier */
+                ks[top] = r1;
+                bs[top++] = std::move(b);
+                ks[top] = k * r2;
+                bs[top++] = std::move(r3);
+                ks[top] = one;
+                bs[top++] = -r2;
+                ks[top] = std::move(k);
+                bs[top++] = -r1;
+                break;
+            }
+            default:
+                std::exit(-99);
+            }
+        }
+    }
+};
+
+template <PROG_TYPENAMES_, typename TKeys>
+struct UngarbleProgram
+{
+    typedef Program<PROG_TYPENAME_ARGS_> ProgramType;
+    typedef TKeys KeysType;
+    typedef typename TKeys::RingType TKRing;
+
+    /* Runs the instructions of each of the outputs [outputBegin,
+     * outputEnd) backwards, so the values of the visits of a gate are on
+     * the stack, the first on the top, when the gate is reached. */
+    template <typename TOutputIt>
+    UngarbleProgram(
+        ProgramType const &program,
+        size_t outputBegin, size_t outputEnd,
+        KeysType &keys,
+        TOutputIt outputIt
+    )
+    {
+        std::vector<TKRing> values(program.UngarbleDepth);
+        auto const code = program.Instructions.data();
+        for (size_t o = outputBegin; o != outputEnd; ++o)
+        {
+            size_t top = 0;
+            for (size_t i = program.OutputBegin[o + 1]; i-- != program.OutputBegin[o]; )
+            {
+                auto const &ins = code[i];
+                switch (ins.Op)
+                {
+                case Operation::ConstZero:
+                case Operation::ConstOne:
+                case Operation::ConstMinusOne:
+                    values[top++] = std::move(keys.OfflineEncoding[ins.Position]);
+                    break;
+                case Operation::AliceInput:
+                    values[top++] = std::move(KeySlot(keys.AliceEncoding, ins));
+                    break;
+                case Operation::BobInput:
+                    values[top++] = std::move(KeySlot(keys.BobEncoding, ins));
+                    break;
+                case Operation::Addition:
+                    --top;
+                    values[top - 1] = std::move(values[top]) + std::move(values[top - 1]);
+                    break;
+                case Operation::Negation:
+                    break;
+                case Operation::Subtraction:
+                    --top;
+                    values[top - 1] = std::move(values[top]) - std::move(values[top - 1]);
+                    break;
+                case Operation::Multiplication:
+                    top -= 3;
+                    values[top - 1] = std::move(values[top + 2]) * std::move(values[top + 1])
+                        + (std::move(values[top]) + std::move(values[top - 1]));
+                    break;
+                default:
+                    std::exit(-99);
+                }
+            }
+            *outputIt = std::move(values[0]);
+            ++outputIt;
+        }
+    }
+};
+
+/* instructions below which no range is split off */
+constexpr size_t MinimumInstructionsPerPart = (size_t)1 << 16;
+
+template <PROG_TYPENAMES_>
+size_t UsefulParts(Program<PROG_TYPENAME_ARGS_> const &program, size_t parts)
+{
+    parts = std::min(parts, program.Instructions.size() / MinimumInstructionsPerPart);
+    return parts ? parts : 1;
+}
+
+/* The first output of the part-th of parts ranges of outputs with about
+ * the same number of instructions; part == parts gives OutputCount. */
+template <PROG_TYPENAMES_>
+size_t SplitOutputs(Program<PROG_TYPENAME_ARGS_> const &program, size_t part, size_t parts)
+{
+    auto const &begin = program.OutputBegin;
+    auto const target = program.Instructions.size() * part / parts;
+    return std::lower_bound(begin.begin(), begin.end(), target) - begin.begin();
+}
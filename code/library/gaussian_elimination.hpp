@@ -0,0 +1,161 @@
+#ifndef GAUSSIAN_ELIMINATION_HPP_
+#define GAUSSIAN_ELIMINATION_HPP_
+
+#include<cstddef>
+#include<algorithm>
+#include<utility>
+#include"cryptography.hpp"
+#include"field_kernels.hpp"
+#include"thread_pool.hpp"
+
+namespace Cryptography
+{
+namespace GaussianElimination
+{
+    /* The pool that runs the trailing updates of SolveDestructive
+     * when none is given, null (the calling thread only) by default.
+     */
+    inline Concurrency::WorkStealingThreadPool *&ThreadPool()
+    {
+        static Concurrency::WorkStealingThreadPool *pool = nullptr;
+        return pool;
+    }
+
+    namespace GaussianEliminationImpl_
+    {
+        /* columns per panel */
+        constexpr size_t BlockSize = 32;
+        /* multiply-subtracts below which no range of rows is split off */
+        constexpr size_t MinimumWorkPerThread = (size_t)1 << 16;
+
+        /* Subtracts L[j][panel] * U[panel][trailing] from the trailing
+         * columns of rows [rowBegin, rowEnd), where the multipliers L are
+         * stored in the panel columns of each row and U in the panel rows.
+         */
+        template <typename TRing>
+        void UpdateRows
+        (
+            TRing *matrix, size_t width,
+            size_t panel, size_t panelSize,
+            size_t rowBegin, size_t rowEnd
+        )
+        {
+            size_t trailing = panel + panelSize;
+            TRing const *sources = matrix + panel * width + trailing;
+            for (size_t j = rowBegin; j != rowEnd; ++j)
+            {
+                TRing *row = matrix + j * width;
+                if (std::none_of(row + panel, row + trailing,
+                    [](TRing const &x) { return (bool)x; }))
+                    continue;
+                FieldKernels::SubtractCombination(row + trailing,
+                    (TRing const *)row + panel, sources, width,
+                    panelSize, width - trailing);
+            }
+        }
+
+        template <typename TRing>
+        void ParallelUpdateRows
+        (
+            TRing *matrix, size_t width,
+            size_t panel, size_t panelSize,
+            size_t rowBegin, size_t rowEnd,
+            Concurrency::WorkStealingThreadPool *pool
+        )
+        {
+            size_t work = (rowEnd - rowBegin) * (width - panel - panelSize) * panelSize;
+            size_t parts = pool ? pool->Size() + 1 : 1;
+            parts = std::min(parts, work / MinimumWorkPerThread);
+            parts = std::min(parts, rowEnd - rowBegin);
+            if (parts <= 1)
+            {
+                UpdateRows(matrix, width, panel, panelSize, rowBegin, rowEnd);
+                return;
+            }
+            size_t rows = rowEnd - rowBegin;
+            pool->ParallelFor(parts, [=](size_t i)
+            {
+                UpdateRows(matrix, width, panel, panelSize,
+                    rowBegin + rows * i / parts, rowBegin + rows * (i + 1) / parts);
+            });
+        }
+    }
+
+    /* Solves the augmented system matrix = TRing[validRows * (K + R)]
+     * (row-major, validRows >= K) with R right-hand sides.
+     * The elimination is blocked by panels of columns: each panel is
+     * factorised, then the rows below it are updated at once, in
+     * parallel on pool and the calling thread. On success, the
+     * solutions are in the last R columns of the first K rows.
+     */
+    template <typename TRing, typename TInverseFunctor>
+    bool SolveDestructive
+    (
+        size_t K,
+        size_t R,
+        size_t validRows,
+        TRing *matrix,
+        TInverseFunctor inverse,
+        Concurrency::WorkStealingThreadPool *pool = ThreadPool()
+    )
+    {
+        using namespace GaussianEliminationImpl_;
+        size_t width = K + R;
+        if (validRows < K)
+            return false;
+        for (size_t panel = 0; panel < K; panel += BlockSize)
+        {
+            size_t panelSize = std::min(BlockSize, K - panel);
+            size_t panelEnd = panel + panelSize;
+            /* factorise the panel columns; the pivot rows are not normalised,
+             * the multipliers replace the eliminated entries and the inverse
+             * of each pivot replaces it on the diagonal */
+            for (size_t i = panel; i != panelEnd; ++i)
+            {
+                TRing *pivotRow = matrix + i * width;
+                if (!(bool)pivotRow[i])
+                {
+                    size_t j = i + 1;
+                    while (j != validRows && !(bool)matrix[j * width + i])
+                        ++j;
+                    if (j == validRows)
+                        return false;
+                    std::swap_ranges(pivotRow, pivotRow + width, matrix + j * width);
+                }
+                auto invLeading = inverse(pivotRow[i]);
+                for (size_t j = i + 1; j != validRows; ++j)
+                {
+                    TRing *row = matrix + j * width;
+                    if (!(bool)row[i])
+                        continue;
+                    row[i] *= invLeading;
+                    FieldKernels::Axpy(row + i + 1, -row[i],
+                        (TRing const *)pivotRow + i + 1, panelEnd - i - 1);
+                }
+                pivotRow[i] = std::move(invLeading);
+            }
+            /* the panel rows to the right of the panel */
+            for (size_t i = panel + 1; i != panelEnd; ++i)
+                FieldKernels::SubtractCombination(matrix + i * width + panelEnd,
+                    (TRing const *)matrix + i * width + panel,
+                    (TRing const *)matrix + panel * width + panelEnd, width,
+                    i - panel, width - panelEnd);
+            /* the rows below the panel; after the last panel, the rows
+             * beyond K are no longer needed */
+            ParallelUpdateRows(matrix, width, panel, panelSize, panelEnd,
+                panelEnd == K ? K : validRows, pool);
+        }
+        /* substitution */
+        for (size_t i = K; i--; )
+        {
+            TRing *row = matrix + i * width;
+            FieldKernels::SubtractCombination(row + K, (TRing const *)row + i + 1,
+                (TRing const *)matrix + (i + 1) * width + K, width, K - i - 1, R);
+            FieldKernels::Scale(row + K, (TRing const *)row + K, row[i], R);
+        }
+        return true;
+    }
+}
+}
+
+#endif // GAUSSIAN_ELIMINATION_HPP_
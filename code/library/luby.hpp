@@ -5,9 +5,16 @@
 #include<vector>
 #include<set>
 #include<utility>
+#include<algorithm>
 #include<random>
 #include<cstring>
+#include<cstddef>
+#include<cstdint>
+#include<iterator>
 #include"helpers.hpp"
+#include"cryptography.hpp"
+#include"field_kernels.hpp"
+#include"gaussian_elimination.hpp"
 
 namespace Encoding
 {
@@ -107,6 +114,110 @@ namespace LubyTransform
         }
     };
 
+    /* Bins stored as offsets into the storage (bin i is from
+     * offsets[i] to offsets[i + 1]), seen as a random access iterator
+     * of LubyBin, so that they can be passed where LubyBin const * is.
+     */
+    template <typename TOffset>
+    struct LubyOffsetIterator
+    {
+        typedef std::random_access_iterator_tag iterator_category;
+        typedef LubyBin value_type;
+        typedef ptrdiff_t difference_type;
+        typedef LubyBin reference;
+        struct pointer
+        {
+            LubyBin Bin;
+            LubyBin const *operator -> () const
+            {
+                return &Bin;
+            }
+        };
+
+        TOffset const *Offset;
+
+        LubyBin operator * () const
+        {
+            return LubyBin{(size_t)Offset[0], (size_t)(Offset[1] - Offset[0])};
+        }
+        pointer operator -> () const
+        {
+            return pointer{**this};
+        }
+        LubyBin operator [] (difference_type n) const
+        {
+            return *(*this + n);
+        }
+        LubyOffsetIterator &operator ++ ()
+        {
+            ++Offset;
+            return *this;
+        }
+        LubyOffsetIterator operator ++ (int)
+        {
+            return LubyOffsetIterator{Offset++};
+        }
+        LubyOffsetIterator &operator -- ()
+        {
+            --Offset;
+            return *this;
+        }
+        LubyOffsetIterator operator -- (int)
+        {
+            return LubyOffsetIterator{Offset--};
+        }
+        LubyOffsetIterator &operator += (difference_type n)
+        {
+            Offset += n;
+            return *this;
+        }
+        LubyOffsetIterator &operator -= (difference_type n)
+        {
+            Offset -= n;
+            return *this;
+        }
+        friend LubyOffsetIterator operator + (LubyOffsetIterator i, difference_type n)
+        {
+            return i += n;
+        }
+        friend LubyOffsetIterator operator + (difference_type n, LubyOffsetIterator i)
+        {
+            return i += n;
+        }
+        friend LubyOffsetIterator operator - (LubyOffsetIterator i, difference_type n)
+        {
+            return i -= n;
+        }
+        friend difference_type operator - (LubyOffsetIterator const &a, LubyOffsetIterator const &b)
+        {
+            return a.Offset - b.Offset;
+        }
+        friend bool operator == (LubyOffsetIterator const &a, LubyOffsetIterator const &b)
+        {
+            return a.Offset == b.Offset;
+        }
+        friend bool operator != (LubyOffsetIterator const &a, LubyOffsetIterator const &b)
+        {
+            return a.Offset != b.Offset;
+        }
+        friend bool operator < (LubyOffsetIterator const &a, LubyOffsetIterator const &b)
+        {
+            return a.Offset < b.Offset;
+        }
+        friend bool operator > (LubyOffsetIterator const &a, LubyOffsetIterator const &b)
+        {
+            return a.Offset > b.Offset;
+        }
+        friend bool operator <= (LubyOffsetIterator const &a, LubyOffsetIterator const &b)
+        {
+            return a.Offset <= b.Offset;
+        }
+        friend bool operator >= (LubyOffsetIterator const &a, LubyOffsetIterator const &b)
+        {
+            return a.Offset >= b.Offset;
+        }
+    };
+
     template
     <
         typename TForwardInputIt1,
@@ -130,15 +241,211 @@ namespace LubyTransform
         TRandomAccessInputIt5 const &decoded
     )
     {
+        typedef typename std::iterator_traits<TForwardInputOutputIt3>::value_type TRing;
+        typedef Cryptography::Accumulator<TRing> TAccumulator;
         for (; binsBegin != binsEnd;
             ++binsBegin, ++encoded, ++notNoisy)
-            if (*notNoisy)
+            if (!*notNoisy)
+                continue;
+            else if (binsBegin->Degree < TAccumulator::Capacity())
+            {
+                /* reduce once per bin */
+                TAccumulator sum(*encoded);
+                for (auto j = binsBegin->GetBegin(storage),
+                    k = binsBegin->GetEnd(storage);
+                    j != k; ++j)
+                    sum.Add(decoded[*j]);
+                *encoded = sum.Result();
+            }
+            else
                 for (auto j = binsBegin->GetBegin(storage),
                     k = binsBegin->GetEnd(storage);
                     j != k; ++j)
                     *encoded += decoded[*j];
     }
 
+    /* LTEncode for count instances at once, interleaved: element k of
+     * instance q is at k * count + q of decoded = F[decodedSize * count]
+     * and of encoded = F[encodedSize * count]. Every bin is encoded. The
+     * inputs of a bin are read once for all the instances.
+     */
+    template
+    <
+        typename TForwardInputIt1,
+        typename TRandomAccessInputIt2,
+        typename TRing
+    >
+    void LTEncodeMultiple
+    (
+        /* [binsBegin, binsEnd) = LubyBin[encodedSize] */
+        TForwardInputIt1 binsBegin,
+        TForwardInputIt1 const &binsEnd,
+        /* size_t[] */
+        TRandomAccessInputIt2 const &storage,
+        size_t count,
+        TRing *encoded,
+        TRing const *decoded
+    )
+    {
+        if (!Cryptography::FieldKernels::AdditionVectorised<TRing>())
+        {
+            /* gathering the rows does not pay off without a vector path */
+            for (; binsBegin != binsEnd; ++binsBegin, encoded += count)
+                for (auto j = binsBegin->GetBegin(storage),
+                    k = binsBegin->GetEnd(storage);
+                    j != k; ++j)
+                {
+                    TRing const *row = decoded + *j * count;
+                    for (size_t q = 0; q != count; ++q)
+                        encoded[q] += row[q];
+                }
+            return;
+        }
+        constexpr size_t ChunkTerms = 32;
+        TRing const *sources[ChunkTerms];
+        for (; binsBegin != binsEnd; ++binsBegin, encoded += count)
+        {
+            auto j = binsBegin->GetBegin(storage);
+            for (size_t t = 0, degree = binsBegin->Degree; t != degree; )
+            {
+                size_t const terms = std::min(degree - t, ChunkTerms);
+                for (size_t u = 0; u != terms; ++u, ++j)
+                    sources[u] = decoded + *j * count;
+                Cryptography::FieldKernels::AddRows(encoded,
+                    (TRing const *const *)sources, terms, count);
+                t += terms;
+            }
+        }
+    }
+
+    /* The bins of a code transposed for LTEncodeScheduled: by blocks of
+     * SparseBlockRows consecutive bins, input t of bin r of a block is at
+     * t * SparseBlockRows + r of the block (see FieldKernels::AddSparseSums),
+     * the bins of a block being padded with NoInput to the largest degree.
+     * Blocks that would be padded to more than twice their edges, and the
+     * bins after the last whole block, are encoded bin by bin instead.
+     */
+    template <typename TIndex = uint32_t>
+    struct LTEncodeSchedule
+    {
+        static constexpr TIndex NoInput = (TIndex)-1;
+
+        /* for each whole block, its largest degree, or 0 for bin by bin */
+        std::vector<uint32_t> BlockDegrees;
+        std::vector<TIndex> Inputs;
+
+        /* Returns false if some input does not fit in TIndex. */
+        template <typename TRandomAccessInputIt1, typename TRandomAccessInputIt2>
+        bool Build
+        (
+            size_t inputSymbolSize,
+            /* [binsBegin, binsEnd) = LubyBin[encodedSize] */
+            TRandomAccessInputIt1 const &binsBegin,
+            TRandomAccessInputIt1 const &binsEnd,
+            TRandomAccessInputIt2 const &storage
+        )
+        {
+            using Cryptography::FieldKernels::SparseBlockRows;
+            if (inputSymbolSize > (size_t)NoInput || inputSymbolSize > (size_t)1 << 31)
+                return false;
+            size_t const blocks = (binsEnd - binsBegin) / SparseBlockRows;
+            BlockDegrees.resize(blocks);
+            Inputs.clear();
+            for (size_t b = 0; b != blocks; ++b)
+            {
+                auto const bins = binsBegin + b * SparseBlockRows;
+                size_t degree = 0, edges = 0;
+                for (size_t r = 0; r != SparseBlockRows; ++r)
+                {
+                    degree = std::max(degree, (size_t)bins[r].Degree);
+                    edges += bins[r].Degree;
+                }
+                if (degree * SparseBlockRows > 2 * edges)
+                    degree = 0;
+                BlockDegrees[b] = (uint32_t)degree;
+                size_t const offset = Inputs.size();
+                Inputs.resize(offset + degree * SparseBlockRows, NoInput);
+                for (size_t r = 0; r != SparseBlockRows && degree; ++r)
+                {
+                    auto j = bins[r].GetBegin(storage);
+                    for (size_t t = 0; t != (size_t)bins[r].Degree; ++t, ++j)
+                        Inputs[offset + t * SparseBlockRows + r] = (TIndex)*j;
+                }
+            }
+            return true;
+        }
+    };
+
+    template <typename TIndex>
+    constexpr TIndex LTEncodeSchedule<TIndex>::NoInput;
+
+    /* LTEncode with a schedule built from the same bins: the whole
+     * blocks are encoded by Cryptography::FieldKernels::AddSparseSums,
+     * which gathers the inputs of SparseBlockRows bins at a time, and
+     * the rest by LTEncode. The result is the same as LTEncode, which
+     * is used for everything if the kernels have no vector path.
+     */
+    template
+    <
+        typename TIndex,
+        typename TRandomAccessInputIt1,
+        typename TRandomAccessInputIt2,
+        typename TRing,
+        typename TInputIt4
+    >
+    void LTEncodeScheduled
+    (
+        LTEncodeSchedule<TIndex> const &schedule,
+        /* [binsBegin, binsEnd) = LubyBin[encodedSize] */
+        TRandomAccessInputIt1 const &binsBegin,
+        TRandomAccessInputIt1 const &binsEnd,
+        /* size_t[] */
+        TRandomAccessInputIt2 const &storage,
+        /* F[encodedSize] = 0 */
+        TRing *encoded,
+        /* bool[encodedSize] */
+        TInputIt4 notNoisy,
+        /* F[decodedSize] */
+        TRing const *decoded
+    )
+    {
+        using Cryptography::FieldKernels::SparseBlockRows;
+        /* the transposed layout only pays off with vectors */
+        if (!Cryptography::FieldKernels::AdditionVectorised<TRing>())
+        {
+            LTEncode(binsBegin, binsEnd, storage, encoded, notNoisy, decoded);
+            return;
+        }
+        constexpr size_t MaskBlocks = 16;
+        unsigned char mask[MaskBlocks * SparseBlockRows];
+        size_t const blocks = schedule.BlockDegrees.size();
+        auto const degrees = schedule.BlockDegrees.data();
+        auto inputs = schedule.Inputs.data();
+        for (size_t b = 0; b != blocks; )
+        {
+            size_t const count = std::min(blocks - b, MaskBlocks);
+            auto const bins = binsBegin + b * SparseBlockRows;
+            for (size_t i = 0; i != count * SparseBlockRows; ++i, ++notNoisy)
+                mask[i] = *notNoisy ? 1 : 0;
+            Cryptography::FieldKernels::AddSparseSums(encoded + b * SparseBlockRows,
+                (unsigned char const *)mask, inputs, degrees + b, decoded, count);
+            for (size_t i = 0; i != count; ++i)
+            {
+                inputs += degrees[b + i] * SparseBlockRows;
+                if (!degrees[b + i])
+                {
+                    auto const first = bins + i * SparseBlockRows;
+                    LTEncode(first, first + SparseBlockRows, storage,
+                        encoded + (b + i) * SparseBlockRows,
+                        (unsigned char const *)mask + i * SparseBlockRows, decoded);
+                }
+            }
+            b += count;
+        }
+        LTEncode(binsBegin + blocks * SparseBlockRows, binsEnd, storage,
+            encoded + blocks * SparseBlockRows, notNoisy, decoded);
+    }
+
     template
     <
         typename TRandomAccessInputOutputIt1,
@@ -292,6 +599,363 @@ namespace LubyTransform
         return !remaining;
     }
 
+    /* For each input, the bins in which it appears, compressed.
+     * It depends only on the code and can be built once for all
+     * decodings with it. The indices are 32-bit to halve the memory
+     * traffic of peeling, so the code must have fewer than 2^32 edges.
+     */
+    struct LTPeelingIndex
+    {
+        /* Entries BinOffsets[t] to BinOffsets[t + 1] - 1 of Bins
+         * are the bins in which input t appears. */
+        std::vector<uint32_t> BinOffsets;
+        std::vector<uint32_t> Bins;
+
+        template
+        <
+            typename TForwardInputIt1,
+            typename TRandomAccessInputIt2
+        >
+        void Build
+        (
+            size_t inputSymbolSize,
+            /* [binsBegin, binsEnd) = LubyBin[encodedSize] */
+            TForwardInputIt1 const &binsBegin,
+            TForwardInputIt1 const &binsEnd,
+            /* size_t[] */
+            TRandomAccessInputIt2 const &storage
+        )
+        {
+            BinOffsets.assign(inputSymbolSize + 1, 0);
+            uint32_t edges = 0;
+            for (auto bin = binsBegin; bin != binsEnd; ++bin)
+                for (auto j = bin->GetBegin(storage),
+                    k = bin->GetEnd(storage);
+                    j != k; ++j, ++edges)
+                    ++BinOffsets[*j + 1];
+            for (size_t t = 0; t != inputSymbolSize; ++t)
+                BinOffsets[t + 1] += BinOffsets[t];
+            /* BinOffsets[t] is used as the cursor of input t,
+             * then shifted back */
+            Bins.resize(edges);
+            uint32_t b = 0;
+            for (auto bin = binsBegin; bin != binsEnd; ++bin, ++b)
+                for (auto j = bin->GetBegin(storage),
+                    k = bin->GetEnd(storage);
+                    j != k; ++j)
+                    Bins[BinOffsets[*j]++] = b;
+            for (size_t t = inputSymbolSize; t; --t)
+                BinOffsets[t] = BinOffsets[t - 1];
+            BinOffsets[0] = 0;
+        }
+    };
+
+    /* The mutable state of LTDecodePeeling and LTDecodeInactivation,
+     * reusable across decodings so that neither the code nor the
+     * encoded symbols are modified.
+     */
+    template <typename TRing>
+    struct LTDecodeWorkspace
+    {
+        /* for each bin, the remaining degree (0 for a noisy bin) in the
+         * high half and the XOR of the remaining inputs in the low half */
+        std::vector<size_t> States;
+        /* for each bin, the encoded symbol minus the solved inputs */
+        std::vector<TRing> Values;
+        /* pairs of a bin of degree 1 and its last input */
+        std::vector<size_t> Queue;
+        std::vector<unsigned char> Solved;
+        /* used by LTDecodeInactivation only */
+        std::vector<size_t> Events;
+        std::vector<TRing> Forms;
+        std::vector<TRing> Core;
+        /* the number of inputs inactivated by the last LTDecodeInactivation */
+        size_t Inactivated = 0;
+    };
+
+    namespace LTDecodeImpl_
+    {
+        /* the degree is kept in the high half of a state */
+        constexpr size_t Half = sizeof(size_t) * 4;
+        constexpr size_t One = (size_t)1 << Half;
+        /* the bin of an inactivation in LTDecodeWorkspace::Events */
+        constexpr size_t NoBin = (size_t)0 - 1;
+
+        /* Removes input t from its bins, queueing those left with one
+         * input, and calls visit(c) for each bin c of t. */
+        template <typename TVisit>
+        void RemoveInput
+        (
+            LTPeelingIndex const &index,
+            size_t t,
+            size_t *states,
+            size_t *queue,
+            size_t &queueEnd,
+            TVisit &&visit
+        )
+        {
+            for (auto j = index.Bins.data() + index.BinOffsets[t],
+                k = index.Bins.data() + index.BinOffsets[t + 1];
+                j != k; ++j)
+            {
+                /* the values of noisy and used bins are no longer
+                 * needed, so only the degree is guarded */
+                size_t const c = *j;
+                size_t state = states[c] ^ t;
+                state -= (size_t)(state >= One) << Half;
+                states[c] = state;
+                visit(c);
+                if ((state >> Half) == 1)
+                {
+                    queue[queueEnd++] = c;
+                    queue[queueEnd++] = state & (One - 1);
+                }
+            }
+        }
+    }
+
+    /* Peels the code from the bins of degree 1: solving an input
+     * removes it from every bin in which it appears, and the bins that
+     * become of degree 1 are queued with their last input. Each edge is
+     * visited a constant number of times. The inputs must be fewer than
+     * 2^(half of the bits of size_t).
+     */
+    template
+    <
+        typename TRing,
+        typename TForwardInputIt1,
+        typename TRandomAccessInputIt2,
+        typename TRandomAccessOutputIt3,
+        typename TForwardInputIt4,
+        typename TForwardInputIt5
+    >
+    bool LTDecodePeeling
+    (
+        LTPeelingIndex const &index,
+        /* [binsBegin, binsEnd) = LubyBin[encodedSize] */
+        TForwardInputIt1 const &binsBegin,
+        TForwardInputIt1 const &binsEnd,
+        /* size_t[] */
+        TRandomAccessInputIt2 const &storage,
+        /* F[decodedSize] */
+        TRandomAccessOutputIt3 const &decoded,
+        /* bool[encodedSize] */
+        TForwardInputIt4 notNoisy,
+        /* F[encodedSize] */
+        TForwardInputIt5 encoded,
+        LTDecodeWorkspace<TRing> &workspace
+    )
+    {
+        using namespace LTDecodeImpl_;
+        size_t remaining = index.BinOffsets.size() - 1;
+        size_t const encodedSize = std::distance(binsBegin, binsEnd);
+        auto &states = workspace.States;
+        auto &values = workspace.Values;
+        auto &queue = workspace.Queue;
+        auto &solved = workspace.Solved;
+        states.resize(encodedSize);
+        values.resize(encodedSize);
+        queue.resize(2 * encodedSize);
+        solved.assign(remaining, 0);
+        size_t queueEnd = 0;
+        size_t b = 0;
+        for (auto bin = binsBegin; bin != binsEnd; ++bin, ++b, ++notNoisy, ++encoded)
+        {
+            size_t state = 0;
+            if (*notNoisy)
+            {
+                for (auto j = bin->GetBegin(storage),
+                    k = bin->GetEnd(storage);
+                    j != k; ++j)
+                    state = (state + One) ^ *j;
+                values[b] = *encoded;
+            }
+            states[b] = state;
+            if ((state >> Half) == 1)
+            {
+                queue[queueEnd++] = b;
+                queue[queueEnd++] = state & (One - 1);
+            }
+        }
+        for (size_t queueBegin = 0; queueBegin != queueEnd && remaining; )
+        {
+            b = queue[queueBegin++];
+            size_t const t = queue[queueBegin++];
+            /* the bin has lost its last input if that is solved */
+            if (solved[t])
+                continue;
+            solved[t] = 1;
+            --remaining;
+            TRing const value = values[b];
+            RemoveInput(index, t, states.data(), queue.data(), queueEnd,
+                [&](size_t c) { values[c] -= value; });
+            decoded[t] = value;
+        }
+        return !remaining;
+    }
+
+    /* Same as LTDecodePeeling, but when peeling stalls, inactivates an
+     * input of a bin of the smallest degree (treating it as an unknown)
+     * and peels on, until every input is solved or inactive. The solved
+     * inputs are tracked as linear forms in the inactive ones, the
+     * remaining bins give a dense system in the inactive inputs, solved
+     * by Cryptography::GaussianElimination, and the peeling is replayed
+     * with their values. At most maxInactivated inputs are inactivated;
+     * workspace.Inactivated is their number.
+     */
+    template
+    <
+        typename TRing,
+        typename TRandomAccessInputIt1,
+        typename TRandomAccessInputIt2,
+        typename TRandomAccessOutputIt3,
+        typename TForwardInputIt4,
+        typename TForwardInputIt5,
+        typename TInverseFunctor
+    >
+    bool LTDecodeInactivation
+    (
+        LTPeelingIndex const &index,
+        /* [binsBegin, binsEnd) = LubyBin[encodedSize] */
+        TRandomAccessInputIt1 const &binsBegin,
+        TRandomAccessInputIt1 const &binsEnd,
+        /* size_t[] */
+        TRandomAccessInputIt2 const &storage,
+        /* F[decodedSize] */
+        TRandomAccessOutputIt3 const &decoded,
+        /* bool[encodedSize] */
+        TForwardInputIt4 const &notNoisy,
+        /* F[encodedSize] */
+        TForwardInputIt5 const &encoded,
+        LTDecodeWorkspace<TRing> &workspace,
+        TInverseFunctor inverse,
+        size_t maxInactivated
+    )
+    {
+        using namespace LTDecodeImpl_;
+        workspace.Inactivated = 0;
+        if (LTDecodePeeling(index, binsBegin, binsEnd, storage,
+            decoded, notNoisy, encoded, workspace))
+            return true;
+        size_t const encodedSize = binsEnd - binsBegin;
+        auto &states = workspace.States;
+        auto &values = workspace.Values;
+        auto &queue = workspace.Queue;
+        auto &solved = workspace.Solved;
+        auto &events = workspace.Events;
+        size_t remaining = std::count(solved.begin(), solved.end(), 0);
+        size_t inactivated = 0;
+        events.clear();
+        /* 1. peel on symbolically, recording the order */
+        auto const ignore = [](size_t) { };
+        while (remaining)
+        {
+            size_t best = encodedSize, bestDegree = (size_t)0 - 1;
+            for (size_t b = 0; b != encodedSize && bestDegree != 2; ++b)
+            {
+                size_t const degree = states[b] >> Half;
+                if (degree >= 2 && degree < bestDegree)
+                {
+                    best = b;
+                    bestDegree = degree;
+                }
+            }
+            /* the remaining inputs are in no bin */
+            if (best == encodedSize || inactivated == maxInactivated)
+                return false;
+            auto const bin = binsBegin + best;
+            auto j = bin->GetBegin(storage);
+            while (solved[*j])
+                ++j;
+            size_t t = *j;
+            solved[t] = 1;
+            --remaining;
+            ++inactivated;
+            events.push_back(NoBin);
+            events.push_back(t);
+            size_t queueEnd = 0;
+            RemoveInput(index, t, states.data(), queue.data(), queueEnd, ignore);
+            for (size_t queueBegin = 0; queueBegin != queueEnd && remaining; )
+            {
+                size_t const b = queue[queueBegin++];
+                t = queue[queueBegin++];
+                if (solved[t])
+                    continue;
+                solved[t] = 1;
+                --remaining;
+                events.push_back(b);
+                events.push_back(t);
+                RemoveInput(index, t, states.data(), queue.data(), queueEnd, ignore);
+            }
+        }
+        workspace.Inactivated = inactivated;
+        /* 2. the value of each bin as a constant and the coefficients of
+         * the inactive inputs */
+        size_t const width = inactivated + 1;
+        auto &forms = workspace.Forms;
+        forms.assign(encodedSize * width, TRing(0));
+        for (size_t b = 0; b != encodedSize; ++b)
+            forms[b * width] = values[b];
+        std::vector<TRing> form(width);
+        for (size_t e = 0, k = 0; e != events.size(); e += 2)
+        {
+            size_t const t = events[e + 1];
+            auto const bins = index.Bins.data();
+            if (events[e] == NoBin)
+            {
+                for (size_t j = index.BinOffsets[t]; j != index.BinOffsets[t + 1]; ++j)
+                    forms[bins[j] * width + 1 + k] -= TRing(1);
+                ++k;
+                continue;
+            }
+            std::copy_n(forms.data() + events[e] * width, width, form.data());
+            /* the forms are short, so the kernels would not pay off */
+            for (size_t j = index.BinOffsets[t]; j != index.BinOffsets[t + 1]; ++j)
+            {
+                TRing *row = forms.data() + bins[j] * width;
+                for (size_t q = 0; q != width; ++q)
+                    row[q] -= form[q];
+            }
+        }
+        /* 3. every noiseless bin is now constant + coefficients * inactive
+         * = 0; those with a coefficient give the dense system, of which a
+         * few more rows than unknowns are tried first */
+        auto &core = workspace.Core;
+        for (size_t maxRows = 2 * inactivated + 16; ; maxRows = encodedSize)
+        {
+            core.clear();
+            size_t rows = 0;
+            auto notNoisyIt = notNoisy;
+            for (size_t b = 0; b != encodedSize && rows != maxRows; ++b, ++notNoisyIt)
+            {
+                TRing const *row = forms.data() + b * width;
+                if (!*notNoisyIt || std::none_of(row + 1, row + width,
+                    [](TRing const &x) { return (bool)x; }))
+                    continue;
+                core.insert(core.end(), row + 1, row + width);
+                core.push_back(-row[0]);
+                ++rows;
+            }
+            if (Cryptography::GaussianElimination::SolveDestructive
+                (inactivated, 1, rows, core.data(), inverse))
+                break;
+            if (rows != maxRows || maxRows == encodedSize)
+                return false;
+        }
+        /* 4. replay the peeling with the values of the inactive inputs */
+        for (size_t e = 0, k = 0; e != events.size(); e += 2)
+        {
+            size_t const t = events[e + 1];
+            TRing const value = events[e] == NoBin
+                ? core[k++ * width + inactivated]
+                : values[events[e]];
+            for (size_t j = index.BinOffsets[t]; j != index.BinOffsets[t + 1]; ++j)
+                values[index.Bins[j]] -= value;
+            decoded[t] = value;
+        }
+        return true;
+    }
+
     template
     <
         typename TAllocLubyBin = std::allocator<LubyBin>,
@@ -385,6 +1049,106 @@ namespace LubyTransform
                 );
         }
 
+        void BuildPeelingIndex(LTPeelingIndex &index) const
+        {
+            index.Build(InputSymbolSize,
+                Bins.data(), Bins.data() + Bins.size(),
+                Storage.data());
+        }
+
+        /* Encodes count instances, see LTEncodeMultiple. */
+        template <typename TRing>
+        void EncodeMultiple(size_t count, TRing *encoded, TRing const *decoded) const
+        {
+            LTEncodeMultiple(Bins.data(), Bins.data() + Bins.size(), Storage.data(),
+                count, encoded, decoded);
+        }
+
+        template <typename TScheduleIndex>
+        bool BuildEncodeSchedule(LTEncodeSchedule<TScheduleIndex> &schedule) const
+        {
+            return schedule.Build(InputSymbolSize,
+                Bins.data(), Bins.data() + Bins.size(),
+                Storage.data());
+        }
+
+        template <typename TScheduleIndex, typename TRing, typename TInputIt4>
+        void EncodeScheduled
+        (
+            LTEncodeSchedule<TScheduleIndex> const &schedule,
+            TRing *encoded,
+            TInputIt4 notNoisy,
+            TRing const *decoded
+        ) const
+        {
+            LTEncodeScheduled
+            (
+                schedule,
+                Bins.data(), Bins.data() + Bins.size(),
+                Storage.data(),
+                encoded, notNoisy, decoded
+            );
+        }
+
+        template
+        <
+            typename TRing,
+            typename TRandomAccessOutputIt3,
+            typename TForwardInputIt4,
+            typename TForwardInputIt5
+        >
+        bool DecodePeeling
+        (
+            LTPeelingIndex const &index,
+            TRandomAccessOutputIt3 decoded,
+            TForwardInputIt4 notNoisy,
+            TForwardInputIt5 encoded,
+            LTDecodeWorkspace<TRing> &workspace
+        ) const
+        {
+            auto binsBegin = Bins.data();
+            auto binsEnd = binsBegin + Bins.size();
+            auto storage = Storage.data();
+            return LTDecodePeeling
+                (
+                    index,
+                    binsBegin, binsEnd, storage,
+                    decoded, notNoisy, encoded,
+                    workspace
+                );
+        }
+
+        template
+        <
+            typename TRing,
+            typename TRandomAccessOutputIt3,
+            typename TForwardInputIt4,
+            typename TForwardInputIt5,
+            typename TInverseFunctor
+        >
+        bool DecodeInactivation
+        (
+            LTPeelingIndex const &index,
+            TRandomAccessOutputIt3 decoded,
+            TForwardInputIt4 notNoisy,
+            TForwardInputIt5 encoded,
+            LTDecodeWorkspace<TRing> &workspace,
+            TInverseFunctor inverse,
+            size_t maxInactivated
+        ) const
+        {
+            auto binsBegin = Bins.data();
+            auto binsEnd = binsBegin + Bins.size();
+            auto storage = Storage.data();
+            return LTDecodeInactivation
+                (
+                    index,
+                    binsBegin, binsEnd, storage,
+                    decoded, notNoisy, encoded,
+                    workspace, inverse, maxInactivated
+                );
+        }
+
         bool LoadFrom(FILE *fp)
         {
             if (fscanf(fp, "%zu", &InputSymbolSize) != 1)
@@ -428,6 +1192,178 @@ namespace LubyTransform
         }
     };
 
+    /* The same code as LTCode, with the bins as offsets and the inputs
+     * as TIndex (uint16_t suffices for fewer than 65536 inputs), in
+     * separate arrays. Encoding and decoding are bound by the loads of
+     * indices, which take 2 or 4 bytes instead of 8 here.
+     */
+    template
+    <
+        typename TIndex = uint32_t,
+        typename TOffset = uint32_t
+    >
+    struct CompactLTCode
+    {
+        typedef LubyOffsetIterator<TOffset> BinIterator;
+
+        size_t InputSymbolSize;
+        /* Offsets.size() is the number of outputs plus one. */
+        std::vector<TOffset> Offsets;
+        std::vector<TIndex> Storage;
+
+        BinIterator BinsBegin() const
+        {
+            return BinIterator{Offsets.data()};
+        }
+        BinIterator BinsEnd() const
+        {
+            return BinIterator{Offsets.data() + Offsets.size() - 1};
+        }
+        size_t OutputSymbolSize() const
+        {
+            return Offsets.size() - 1;
+        }
+
+        /* Returns false (and leaves this object unspecified) if the
+         * inputs or the edges of code do not fit in TIndex or TOffset. */
+        template <typename TAllocLubyBin, typename TAllocSizeT>
+        bool Assign(LTCode<TAllocLubyBin, TAllocSizeT> const &code)
+        {
+            if (code.InputSymbolSize - 1 > (TIndex)-1
+                || code.Storage.size() > (TOffset)-1)
+                return false;
+            InputSymbolSize = code.InputSymbolSize;
+            Offsets.resize(code.Bins.size() + 1);
+            Storage.resize(code.Storage.size());
+            size_t offset = 0;
+            for (size_t i = 0; i != code.Bins.size(); ++i)
+            {
+                auto const &bin = code.Bins[i];
+                Offsets[i] = (TOffset)offset;
+                for (auto j = bin.GetBegin(code.Storage.data()),
+                    k = bin.GetEnd(code.Storage.data());
+                    j != k; ++j)
+                    Storage[offset++] = (TIndex)*j;
+            }
+            Offsets.back() = (TOffset)offset;
+            return true;
+        }
+
+        template
+        <
+            typename TForwardInputOutputIt3,
+            typename TForwardInputIt4,
+            typename TRandomAccessInputIt5
+        >
+        void Encode
+        (
+            TForwardInputOutputIt3 encoded,
+            TForwardInputIt4 notNoisy,
+            TRandomAccessInputIt5 decoded
+        ) const
+        {
+            LTEncode
+            (
+                BinsBegin(), BinsEnd(), Storage.data(),
+                encoded, notNoisy, decoded
+            );
+        }
+
+        void BuildPeelingIndex(LTPeelingIndex &index) const
+        {
+            index.Build(InputSymbolSize,
+                BinsBegin(), BinsEnd(),
+                Storage.data());
+        }
+
+        /* Encodes count instances, see LTEncodeMultiple. */
+        template <typename TRing>
+        void EncodeMultiple(size_t count, TRing *encoded, TRing const *decoded) const
+        {
+            LTEncodeMultiple(BinsBegin(), BinsEnd(), Storage.data(),
+                count, encoded, decoded);
+        }
+
+        template <typename TScheduleIndex>
+        bool BuildEncodeSchedule(LTEncodeSchedule<TScheduleIndex> &schedule) const
+        {
+            return schedule.Build(InputSymbolSize,
+                BinsBegin(), BinsEnd(),
+                Storage.data());
+        }
+
+        template <typename TScheduleIndex, typename TRing, typename TInputIt4>
+        void EncodeScheduled
+        (
+            LTEncodeSchedule<TScheduleIndex> const &schedule,
+            TRing *encoded,
+            TInputIt4 notNoisy,
+            TRing const *decoded
+        ) const
+        {
+            LTEncodeScheduled
+            (
+                schedule,
+                BinsBegin(), BinsEnd(),
+                Storage.data(),
+                encoded, notNoisy, decoded
+            );
+        }
+
+        template
+        <
+            typename TRing,
+            typename TRandomAccessOutputIt3,
+            typename TForwardInputIt4,
+            typename TForwardInputIt5
+        >
+        bool DecodePeeling
+        (
+            LTPeelingIndex const &index,
+            TRandomAccessOutputIt3 decoded,
+            TForwardInputIt4 notNoisy,
+            TForwardInputIt5 encoded,
+            LTDecodeWorkspace<TRing> &workspace
+        ) const
+        {
+            return LTDecodePeeling
+                (
+                    index,
+                    BinsBegin(), BinsEnd(), Storage.data(),
+                    decoded, notNoisy, encoded,
+                    workspace
+                );
+        }
+
+        template
+        <
+            typename TRing,
+            typename TRandomAccessOutputIt3,
+            typename TForwardInputIt4,
+            typename TForwardInputIt5,
+            typename TInverseFunctor
+        >
+        bool DecodeInactivation
+        (
+            LTPeelingIndex const &index,
+            TRandomAccessOutputIt3 decoded,
+            TForwardInputIt4 notNoisy,
+            TForwardInputIt5 encoded,
+            LTDecodeWorkspace<TRing> &workspace,
+            TInverseFunctor inverse,
+            size_t maxInactivated
+        ) const
+        {
+            return LTDecodeInactivation
+                (
+                    index,
+                    BinsBegin(), BinsEnd(), Storage.data(),
+                    decoded, notNoisy, encoded,
+                    workspace, inverse, maxInactivated
+                );
+        }
+    };
+
     template
     <
         typename TAllocLubyBin,
@@ -0,0 +1,375 @@
+#ifndef PRG_HPP_
+#define PRG_HPP_
+
+#include<cstddef>
+#include<cstdint>
+#include<cstring>
+#include"cryptography.hpp"
+#include"field_kernels.hpp"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define PRG_X86_
+#include<immintrin.h>
+#ifdef _MSC_VER
+#define PRG_AVX2_
+#define PRG_AVX512_
+#else
+#define PRG_AVX2_ __attribute__((target("avx2")))
+#define PRG_AVX512_ __attribute__((target("avx512f")))
+#endif // _MSC_VER
+#endif // x86
+
+namespace Cryptography
+{
+namespace Prg
+{
+    namespace PrgImpl_
+    {
+        /* The ChaCha20 keystream is produced by chunks of ChunkBlocks
+         * blocks, word-sliced: word w of block b of the chunk is at
+         * w * ChunkBlocks + b, so that a vector of 16 (or two of 8)
+         * lanes computes the same word of 16 blocks. */
+        constexpr size_t ChunkBlocks = 16;
+        constexpr size_t ChunkWords = 16 * ChunkBlocks;
+
+        inline uint32_t RotateLeft(uint32_t x, int r)
+        {
+            return (x << r) | (x >> (32 - r));
+        }
+
+#define PRG_QUARTER_ROUND_(ADD, XOR, ROTATE, a, b, c, d) \
+        a = ADD(a, b); d = XOR(d, a); d = ROTATE(d, 16); \
+        c = ADD(c, d); b = XOR(b, c); b = ROTATE(b, 12); \
+        a = ADD(a, b); d = XOR(d, a); d = ROTATE(d, 8); \
+        c = ADD(c, d); b = XOR(b, c); b = ROTATE(b, 7)
+
+#define PRG_DOUBLE_ROUND_(ADD, XOR, ROTATE, x) \
+        PRG_QUARTER_ROUND_(ADD, XOR, ROTATE, x[0], x[4], x[8], x[12]); \
+        PRG_QUARTER_ROUND_(ADD, XOR, ROTATE, x[1], x[5], x[9], x[13]); \
+        PRG_QUARTER_ROUND_(ADD, XOR, ROTATE, x[2], x[6], x[10], x[14]); \
+        PRG_QUARTER_ROUND_(ADD, XOR, ROTATE, x[3], x[7], x[11], x[15]); \
+        PRG_QUARTER_ROUND_(ADD, XOR, ROTATE, x[0], x[5], x[10], x[15]); \
+        PRG_QUARTER_ROUND_(ADD, XOR, ROTATE, x[1], x[6], x[11], x[12]); \
+        PRG_QUARTER_ROUND_(ADD, XOR, ROTATE, x[2], x[7], x[8], x[13]); \
+        PRG_QUARTER_ROUND_(ADD, XOR, ROTATE, x[3], x[4], x[9], x[14])
+
+        struct Scalar
+        {
+            static uint32_t Add(uint32_t a, uint32_t b)
+            {
+                return a + b;
+            }
+            static uint32_t Xor(uint32_t a, uint32_t b)
+            {
+                return a ^ b;
+            }
+            /* state[12] is the counter of the first block, a multiple
+             * of ChunkBlocks, so the counters of a chunk do not carry. */
+            static void Chunk(uint32_t const *state, uint32_t *out)
+            {
+                for (size_t b = 0; b != ChunkBlocks; ++b)
+                {
+                    uint32_t x[16], s[16];
+                    memcpy(s, state, sizeof(s));
+                    s[12] += (uint32_t)b;
+                    memcpy(x, s, sizeof(x));
+                    for (size_t i = 0; i != 10; ++i)
+                    {
+                        PRG_DOUBLE_ROUND_(Add, Xor, RotateLeft, x);
+                    }
+                    for (size_t w = 0; w != 16; ++w)
+                        out[w * ChunkBlocks + b] = x[w] + s[w];
+                }
+            }
+        };
+
+#ifdef PRG_X86_
+
+        struct Avx2
+        {
+            static PRG_AVX2_ __m256i Add(__m256i a, __m256i b)
+            {
+                return _mm256_add_epi32(a, b);
+            }
+            static PRG_AVX2_ __m256i Xor(__m256i a, __m256i b)
+            {
+                return _mm256_xor_si256(a, b);
+            }
+            static PRG_AVX2_ __m256i Rotate(__m256i x, int r)
+            {
+                /* whole-byte rotations are shuffles */
+                if (r == 16)
+                    return _mm256_shuffle_epi8(x, _mm256_setr_epi8(
+                        2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13,
+                        2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13));
+                if (r == 8)
+                    return _mm256_shuffle_epi8(x, _mm256_setr_epi8(
+                        3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14,
+                        3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14));
+                return _mm256_or_si256(_mm256_slli_epi32(x, r), _mm256_srli_epi32(x, 32 - r));
+            }
+            static PRG_AVX2_ void Chunk(uint32_t const *state, uint32_t *out)
+            {
+                for (size_t half = 0; half != ChunkBlocks; half += 8)
+                {
+                    __m256i x[16], s[16];
+                    for (size_t w = 0; w != 16; ++w)
+                        s[w] = _mm256_set1_epi32((int)state[w]);
+                    s[12] = _mm256_add_epi32(s[12], _mm256_setr_epi32(
+                        (int)half, (int)half + 1, (int)half + 2, (int)half + 3,
+                        (int)half + 4, (int)half + 5, (int)half + 6, (int)half + 7));
+                    for (size_t w = 0; w != 16; ++w)
+                        x[w] = s[w];
+                    for (size_t i = 0; i != 10; ++i)
+                    {
+                        PRG_DOUBLE_ROUND_(Add, Xor, Rotate, x);
+                    }
+                    for (size_t w = 0; w != 16; ++w)
+                        _mm256_storeu_si256((__m256i *)(out + w * ChunkBlocks + half),
+                            _mm256_add_epi32(x[w], s[w]));
+                }
+            }
+        };
+
+        struct Avx512
+        {
+            static PRG_AVX512_ __m512i Add(__m512i a, __m512i b)
+            {
+                return _mm512_add_epi32(a, b);
+            }
+            static PRG_AVX512_ __m512i Xor(__m512i a, __m512i b)
+            {
+                return _mm512_xor_si512(a, b);
+            }
+            static PRG_AVX512_ __m512i Rotate(__m512i x, int r)
+            {
+                /* the unmasked form trips -Wuninitialized in some GCC headers */
+                return _mm512_maskz_rolv_epi32((__mmask16)0xFFFF, x, _mm512_set1_epi32(r));
+            }
+            static PRG_AVX512_ void Chunk(uint32_t const *state, uint32_t *out)
+            {
+                __m512i x[16], s[16];
+                for (size_t w = 0; w != 16; ++w)
+                    s[w] = _mm512_set1_epi32((int)state[w]);
+                s[12] = _mm512_add_epi32(s[12], _mm512_setr_epi32(
+                    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15));
+                for (size_t w = 0; w != 16; ++w)
+                    x[w] = s[w];
+                for (size_t i = 0; i != 10; ++i)
+                {
+                    PRG_DOUBLE_ROUND_(Add, Xor, Rotate, x);
+                }
+                for (size_t w = 0; w != 16; ++w)
+                    _mm512_storeu_si512(out + w * ChunkBlocks, _mm512_add_epi32(x[w], s[w]));
+            }
+        };
+
+#endif // PRG_X86_
+
+#undef PRG_DOUBLE_ROUND_
+#undef PRG_QUARTER_ROUND_
+
+        inline void Chunk(uint32_t const *state, uint32_t *out)
+        {
+#ifdef PRG_X86_
+            switch (FieldKernels::ActiveInstructionSet())
+            {
+            case FieldKernels::InstructionSet::AVX512:
+                Avx512::Chunk(state, out);
+                return;
+            case FieldKernels::InstructionSet::AVX2:
+                Avx2::Chunk(state, out);
+                return;
+            default:
+                break;
+            }
+#endif // PRG_X86_
+            Scalar::Chunk(state, out);
+        }
+
+        /* Ring types whose elements are uint32_t less than P, where
+         * every such uint32_t is an element, so that uniform words
+         * less than P are uniform elements. */
+        template <typename TRing>
+        struct RawTraits
+        {
+            static constexpr bool Raw = false;
+        };
+
+        template <uint32_t p>
+        struct RawTraits<Z<p, uint32_t, uint64_t>>
+        {
+            static constexpr bool Raw = true;
+            static constexpr uint32_t P = p;
+        };
+
+        template <uint32_t p>
+        struct RawTraits<ZMontgomery<p, uint32_t, uint64_t>>
+        {
+            static constexpr bool Raw = true;
+            static constexpr uint32_t P = p;
+        };
+    }
+
+    /* A counter-mode generator over the ChaCha20 keystream of a 256-bit
+     * key and a 64-bit nonce, produced 16 blocks at a time with
+     * Cryptography::FieldKernels::ActiveInstructionSet(). The output is
+     * word-sliced: each chunk of 16 blocks gives word 0 of the 16 blocks,
+     * then word 1 of them, etc., so it is a fixed permutation of the
+     * keystream and not the RFC 8439 byte stream. The output does not
+     * depend on the instruction set.
+     * It satisfies UniformRandomBitGenerator.
+     */
+    struct ChaCha20Generator
+    {
+        typedef uint32_t result_type;
+
+        static constexpr result_type min()
+        {
+            return 0;
+        }
+
+        static constexpr result_type max()
+        {
+            return 0xFFFFFFFFu;
+        }
+
+        /* the all-zero key */
+        ChaCha20Generator()
+        {
+            uint32_t const key[8] = { };
+            Seed(key, 0);
+        }
+
+        /* for std::mt19937-style seeding; prefer Seed(source) */
+        explicit ChaCha20Generator(result_type value)
+        {
+            uint32_t const key[8] = { value };
+            Seed(key, 0);
+        }
+
+        void Seed(uint32_t const *key, uint64_t nonce)
+        {
+            state[0] = 0x61707865u;
+            state[1] = 0x3320646eu;
+            state[2] = 0x79622d32u;
+            state[3] = 0x6b206574u;
+            memcpy(state + 4, key, 8 * sizeof(uint32_t));
+            state[12] = 0;
+            state[13] = 0;
+            state[14] = (uint32_t)nonce;
+            state[15] = (uint32_t)(nonce >> 32);
+            position = PrgImpl_::ChunkWords;
+        }
+
+        /* Takes the key from 8 calls to source(), e.g. std::random_device
+         * or another ChaCha20Generator. */
+        template <typename TSeedSource>
+        void Seed(TSeedSource &source)
+        {
+            uint32_t key[8];
+            for (auto &word : key)
+                word = (uint32_t)source();
+            Seed(key, 0);
+        }
+
+        result_type operator () ()
+        {
+            if (position == PrgImpl_::ChunkWords)
+            {
+                NextChunk(buffer);
+                position = 0;
+            }
+            return buffer[position++];
+        }
+
+        /* The next n outputs, whole chunks directly into out. */
+        void Generate(uint32_t *out, size_t n)
+        {
+            for (; n && position != PrgImpl_::ChunkWords; --n)
+                *out++ = buffer[position++];
+            for (; n >= PrgImpl_::ChunkWords; out += PrgImpl_::ChunkWords, n -= PrgImpl_::ChunkWords)
+                NextChunk(out);
+            if (n)
+            {
+                NextChunk(buffer);
+                memcpy(out, buffer, n * sizeof(uint32_t));
+                position = n;
+            }
+        }
+
+        void discard(unsigned long long z)
+        {
+            for (; z; --z)
+                (*this)();
+        }
+
+    private:
+        uint32_t state[16];
+        size_t position;
+        uint32_t buffer[PrgImpl_::ChunkWords];
+
+        void NextChunk(uint32_t *out)
+        {
+            PrgImpl_::Chunk(state, out);
+            /* 64-bit block counter */
+            state[12] += (uint32_t)PrgImpl_::ChunkBlocks;
+            state[13] += !state[12];
+        }
+    };
+
+    /* The uniform distribution over Z<p> or ZMontgomery<p> (32-bit),
+     * by rejecting the 32-bit words not less than p. The generator
+     * must produce uniform 32-bit words.
+     */
+    template <typename TRing>
+    struct UniformRingDistribution
+    {
+        typedef TRing result_type;
+        typedef PrgImpl_::RawTraits<TRing> Traits;
+        static_assert(Traits::Raw, "TRing must be Z<p> or ZMontgomery<p> with 32-bit elements.");
+
+        template <typename TRandomGenerator>
+        TRing operator () (TRandomGenerator &next)
+        {
+            static_assert(TRandomGenerator::min() == 0
+                && TRandomGenerator::max() >= 0xFFFFFFFFu,
+                "TRandomGenerator must produce 32-bit words.");
+            for (;;)
+            {
+                uint32_t const word = (uint32_t)next();
+                if (word < Traits::P)
+                    return TRing((uint64_t)word);
+            }
+        }
+
+        template <typename TOutputIt, typename TRandomGenerator>
+        void Fill(TOutputIt begin, TOutputIt const &end, TRandomGenerator &next)
+        {
+            for (; begin != end; ++begin)
+                *begin = (*this)(next);
+        }
+
+        /* The keystream is written in place as raw values, then the
+         * rare words not less than p are replaced by later words. The
+         * elements are uniform, but not those operator () would give. */
+        void Fill(TRing *begin, TRing *end, ChaCha20Generator &next)
+        {
+            uint32_t *raw = reinterpret_cast<uint32_t *>(begin);
+            size_t const n = (size_t)(end - begin);
+            next.Generate(raw, n);
+            for (size_t i = 0; i != n; ++i)
+                while (raw[i] >= Traits::P)
+                    raw[i] = next();
+        }
+    };
+}
+}
+
+#ifdef PRG_X86_
+#undef PRG_X86_
+#undef PRG_AVX2_
+#undef PRG_AVX512_
+#endif // PRG_X86_
+
+#endif // PRG_HPP_
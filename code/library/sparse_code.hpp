@@ -6,6 +6,11 @@
 #include<random>
 #include<iterator>
 #include<utility>
+#include<algorithm>
+#include<cstdint>
+#include"cryptography.hpp"
+#include"field_kernels.hpp"
+#include"gaussian_elimination.hpp"
 
 namespace Encoding
 {
@@ -37,14 +42,157 @@ namespace SparseLinearCode
         TForwardInputIt4 &entries
     )
     {
+        typedef typename std::iterator_traits<TForwardInputOutputIt1>::value_type TRing;
+        typedef Cryptography::Accumulator<TRing> TAccumulator;
+        if (D >= TAccumulator::Capacity())
+        {
+            for (; count--; ++encoded, ++notNoisy)
+                if (*notNoisy)
+                    for (size_t i = 0; i != D; ++i, ++entries)
+                        *encoded += entries->Value * decoded[entries->Column];
+                else
+                    std::advance(entries, D);
+            return;
+        }
+        /* reduce once per row */
         for (; count--; ++encoded, ++notNoisy)
             if (*notNoisy)
+            {
+                TAccumulator sum(*encoded);
                 for (size_t i = 0; i != D; ++i, ++entries)
-                    *encoded += entries->Value * decoded[entries->Column];
+                    sum.AddProduct(entries->Value, decoded[entries->Column]);
+                *encoded = sum.Result();
+            }
             else
                 std::advance(entries, D);
     }
 
+    /* Encodes count instances with the same rows at once, interleaved:
+     * element k of instance q is at k * count + q of decoded = TRing[K * count]
+     * and of encoded = TRing[rows * count]. Every row is encoded (noisy rows
+     * are to be overwritten by the caller). Each entry is read once for all
+     * the instances, which are the lanes of Cryptography::FieldKernels.
+     */
+    template
+    <
+        typename TRing,
+        typename TForwardInputIt4
+    >
+    void SparseEncodeMultiple
+    (
+        size_t D,
+        size_t rows,
+        size_t count,
+        TRing *&encoded,
+        TRing const *decoded,
+        TForwardInputIt4 &entries
+    )
+    {
+        constexpr size_t ChunkTerms = 32;
+        TRing coefficients[ChunkTerms];
+        TRing const *sources[ChunkTerms];
+        for (; rows--; encoded += count)
+            for (size_t t = 0; t != D; )
+            {
+                size_t const terms = std::min(D - t, ChunkTerms);
+                for (size_t u = 0; u != terms; ++u, ++entries)
+                {
+                    coefficients[u] = entries->Value;
+                    sources[u] = decoded + entries->Column * count;
+                }
+                Cryptography::FieldKernels::AddCombinationOfRows(encoded,
+                    (TRing const *)coefficients, (TRing const *const *)sources, terms, count);
+                t += terms;
+            }
+    }
+
+    /* SparseEncode over entries split into columns = TColumn[] and
+     * values = TRing[], stored by blocks of rows as described at
+     * Cryptography::FieldKernels::SparseBlockRows (count rows rounded
+     * up to whole blocks).
+     */
+    template
+    <
+        typename TForwardInputOutputIt1,
+        typename TInputIt2,
+        typename TRandomAccessInputIt3,
+        typename TColumn,
+        typename TRing
+    >
+    void SparseEncodeCompact
+    (
+        size_t D,
+        size_t count,
+        /* encoded = TRing[count] */
+        TForwardInputOutputIt1 &encoded,
+        /* notNoisy = bool[count] */
+        TInputIt2 &notNoisy,
+        TRandomAccessInputIt3 decoded,
+        TColumn const *columns,
+        TRing const *values
+    )
+    {
+        using Cryptography::FieldKernels::SparseBlockRows;
+        typedef Cryptography::Accumulator<TRing> TAccumulator;
+        for (size_t i = 0; i != count; ++i, ++encoded, ++notNoisy)
+        {
+            if (!*notNoisy)
+                continue;
+            size_t const r = i % SparseBlockRows;
+            auto c = columns + (i - r) * D + r;
+            auto v = values + (i - r) * D + r;
+            if (D >= TAccumulator::Capacity())
+            {
+                for (size_t t = 0; t != D; ++t, c += SparseBlockRows, v += SparseBlockRows)
+                    *encoded += *v * decoded[*c];
+                continue;
+            }
+            TAccumulator sum(*encoded);
+            for (size_t t = 0; t != D; ++t, c += SparseBlockRows, v += SparseBlockRows)
+                sum.AddProduct(*v, decoded[*c]);
+            *encoded = sum.Result();
+        }
+    }
+
+    /* The same when encoded and decoded are pointers: notNoisy is read
+     * into a mask for a number of blocks at a time, and the blocks are
+     * encoded by Cryptography::FieldKernels::AddSparseProducts.
+     */
+    template
+    <
+        typename TRing,
+        typename TInputIt2,
+        typename TDecodedRing,
+        typename TColumn
+    >
+    void SparseEncodeCompact
+    (
+        size_t D,
+        size_t count,
+        TRing *&encoded,
+        TInputIt2 &notNoisy,
+        /* TRing or TRing const */
+        TDecodedRing *decoded,
+        TColumn const *columns,
+        TRing const *values
+    )
+    {
+        constexpr size_t MaskRows = 16 * Cryptography::FieldKernels::SparseBlockRows;
+        unsigned char mask[MaskRows];
+        while (count)
+        {
+            size_t const rows = std::min(count, MaskRows);
+            for (size_t i = 0; i != rows; ++i, ++notNoisy)
+                mask[i] = *notNoisy ? 1 : 0;
+            Cryptography::FieldKernels::AddSparseProducts(encoded, (unsigned char const *)mask,
+                columns, values, D, (TRing const *)decoded, rows);
+            encoded += rows;
+            columns += rows * D;
+            values += rows * D;
+            count -= rows;
+        }
+    }
+
     struct
     {
         template <typename T>
@@ -54,6 +202,124 @@ namespace SparseLinearCode
         }
     } const DefaultInverseFunctor;
 
+    /* Solves the augmented system matrix = TRing[validRows * (K + R)]
+     * (row-major, validRows >= K) with R right-hand sides by Gaussian
+     * elimination. On success, the solutions are in the last R columns
+     * of the first K rows.
+     */
+    template
+    <
+        typename TRandomAccessInputOutputIt1,
+        typename TInverseFunctor
+    >
+    bool DenseSolveMultipleDestructive
+    (
+        size_t K,
+        size_t R,
+        size_t validRows,
+        TRandomAccessInputOutputIt1 matrix,
+        TInverseFunctor inverse = DefaultInverseFunctor
+    )
+    {
+        size_t width = K + R;
+        if (validRows < K)
+            return false;
+        if (!K)
+            return true;
+        /* elimination */
+        for (size_t i = 0; ; ++i)
+        {
+            if (!(bool)matrix[i * width + i])
+            {
+                bool success = false;
+                for (size_t j = i + 1; j != validRows; ++j)
+                    if ((bool)matrix[j * width + i])
+                    {
+                        std::swap_ranges
+                        (
+                            matrix + i * width,
+                            matrix + (i + 1) * width,
+                            matrix + j * width
+                        );
+                        success = true;
+                        break;
+                    }
+                if (!success)
+                    return false;
+            }
+            /* the pivot row is not normalised; the inverse of the pivot
+             * replaces it on the diagonal and is applied in substitution */
+            auto invLeading = inverse(matrix[i * width + i]);
+            if (i + 1 == K)
+            {
+                matrix[i * width + i] = std::move(invLeading);
+                break;
+            }
+            for (size_t j = i + 1; j != validRows; ++j)
+                if ((bool)matrix[j * width + i])
+                {
+                    auto leading = matrix[j * width + i] * invLeading;
+                    for (size_t k = i + 1; k != width; ++k)
+                        matrix[j * width + k] -= leading * matrix[i * width + k];
+                    matrix[j * width + i] = 0;
+                }
+            matrix[i * width + i] = std::move(invLeading);
+        }
+        /* substitution */
+        for (size_t i = K - 1; ; --i)
+        {
+            for (size_t k = K; k != width; ++k)
+                matrix[i * width + k] *= matrix[i * width + i];
+            if (!i)
+                break;
+            for (size_t j = i - 1; j != (size_t)0 - (size_t)1; --j)
+                if ((bool)matrix[j * width + i])
+                {
+                    auto factor = std::move(matrix[j * width + i]);
+                    for (size_t k = K; k != width; ++k)
+                        matrix[j * width + k] -= factor * matrix[i * width + k];
+                }
+        }
+        return true;
+    }
+
+    /* Contiguous matrices are solved by the blocked elimination of
+     * GaussianElimination::SolveDestructive, on its ThreadPool().
+     */
+    template <typename TRing, typename TInverseFunctor>
+    bool DenseSolveMultipleDestructive
+    (
+        size_t K,
+        size_t R,
+        size_t validRows,
+        TRing *matrix,
+        TInverseFunctor inverse = DefaultInverseFunctor
+    )
+    {
+        return Cryptography::GaussianElimination::SolveDestructive
+            (K, R, validRows, matrix, inverse);
+    }
+
+    /* Solves the augmented system matrix = TRing[validRows * (K + 1)]
+     * (row-major, validRows >= K) by Gaussian elimination. On success,
+     * the solution is in the last column of the first K rows.
+     */
+    template
+    <
+        typename TRandomAccessInputOutputIt1,
+        typename TInverseFunctor
+    >
+    bool DenseSolveDestructive
+    (
+        size_t K,
+        size_t validRows,
+        TRandomAccessInputOutputIt1 matrix,
+        TInverseFunctor inverse = DefaultInverseFunctor
+    )
+    {
+        return DenseSolveMultipleDestructive(K, 1, validRows, matrix, inverse);
+    }
+
     template
     <
         typename TInputIt1,
@@ -94,52 +360,465 @@ namespace SparseLinearCode
                 std::advance(entries, D);
         if (validRows < K)
             return false;
-        /* elimination */
-        for (size_t i = 0; ; ++i)
+        if (!DenseSolveDestructive(K, validRows, matrix, inverse))
+            return false;
+        /* move the results to decoded */
+        matrix += K;
+        for (size_t i = 0; i != K; ++i, ++decoded, matrix += K + 1)
+            *decoded = std::move(*matrix);
+        return true;
+    }
+
+    /* The rows of a sparse matrix, compressed and indexed by column,
+     * with the inverses of their entries. It depends only on the matrix
+     * and can be built once for all decodings from it.
+     */
+    template <typename TRing>
+    struct StructuredDecodeSchedule
+    {
+        size_t K = 0;
+        /* RowOffsets[i] to RowOffsets[i + 1] index the entries of row i;
+         * repeated columns are merged and zeros are dropped */
+        std::vector<size_t> RowOffsets;
+        std::vector<size_t> Columns;
+        std::vector<TRing> Values;
+        /* empty, or the inverses of Values */
+        std::vector<TRing> InverseValues;
+        /* ColumnOffsets[j] to ColumnOffsets[j + 1] index the rows
+         * in which column j appears */
+        std::vector<size_t> ColumnOffsets;
+        std::vector<size_t> ColumnRows;
+
+        size_t Rows() const
+        {
+            return RowOffsets.size() - 1;
+        }
+
+        /* Compresses the rows for which include is true. */
+        template <typename TForwardInputIt1, typename TInputIt2>
+        void Build(size_t columnCount, size_t D, size_t U,
+            TForwardInputIt1 entries, TInputIt2 include)
         {
-            if (!(bool)matrix[i * kPlus1 + i])
+            size_t const none = (size_t)0 - (size_t)1;
+            K = columnCount;
+            RowOffsets.assign(1, 0);
+            Columns.clear();
+            Values.clear();
+            InverseValues.clear();
+            /* ColumnRows temporarily marks the last row of each column */
+            ColumnRows.assign(K, none);
+            size_t rows = 0;
+            for (; U--; ++include)
             {
-                bool success = false;
-                for (size_t j = i + 1; j != validRows; ++j)
-                    if ((bool)matrix[j * kPlus1 + i])
+                if (!*include)
+                {
+                    std::advance(entries, D);
+                    continue;
+                }
+                size_t begin = Columns.size();
+                for (size_t i = 0; i != D; ++i, ++entries)
+                {
+                    size_t col = entries->Column;
+                    if (ColumnRows[col] == rows)
                     {
-                        std::swap_ranges
-                        (
-                            matrix + i * kPlus1,
-                            matrix + (i + 1) * kPlus1,
-                            matrix + j * kPlus1
-                        );
-                        success = true;
-                        break;
+                        size_t k = begin;
+                        while (Columns[k] != col)
+                            ++k;
+                        Values[k] += entries->Value;
+                        continue;
                     }
-                if (!success)
+                    ColumnRows[col] = rows;
+                    Columns.push_back(col);
+                    Values.push_back(entries->Value);
+                }
+                size_t end = begin;
+                for (size_t k = begin; k != Columns.size(); ++k)
+                    if ((bool)Values[k])
+                    {
+                        Columns[end] = Columns[k];
+                        Values[end] = std::move(Values[k]);
+                        ++end;
+                    }
+                Columns.resize(end);
+                Values.resize(end);
+                RowOffsets.push_back(end);
+                ++rows;
+            }
+            /* ColumnOffsets[j] is used as the cursor of column j,
+             * then shifted back */
+            ColumnOffsets.assign(K + 1, 0);
+            for (size_t col : Columns)
+                ++ColumnOffsets[col + 1];
+            for (size_t col = 0; col != K; ++col)
+                ColumnOffsets[col + 1] += ColumnOffsets[col];
+            ColumnRows.resize(Columns.size());
+            for (size_t r = 0; r != rows; ++r)
+                for (size_t k = RowOffsets[r]; k != RowOffsets[r + 1]; ++k)
+                    ColumnRows[ColumnOffsets[Columns[k]]++] = r;
+            for (size_t col = K; col; --col)
+                ColumnOffsets[col] = ColumnOffsets[col - 1];
+            ColumnOffsets[0] = 0;
+        }
+
+        /* Precomputes InverseValues, so that decoding needs no inverse
+         * except in the dense core. */
+        template <typename TInverseFunctor>
+        bool Invert(TInverseFunctor inverse)
+        {
+            std::vector<TRing> scratch(Values.size());
+            InverseValues = Values;
+            return Cryptography::BatchInverse(InverseValues.size(),
+                InverseValues.begin(), scratch.begin(), inverse);
+        }
+    };
+
+    /* Storage for the structured decoders, reused across calls so that
+     * repeated decoding does not allocate.
+     */
+    template <typename TRing>
+    struct StructuredDecodeWorkspace
+    {
+        /* the non-noisy rows, if no schedule is given */
+        StructuredDecodeSchedule<TRing> Schedule;
+        std::vector<bool> RowIncluded;
+        std::vector<TRing> RightHandSides;
+        /* active columns in each row, or (size_t)-1 for excluded
+         * and pivot rows */
+        std::vector<size_t> RowDegrees;
+        std::vector<size_t> BucketHeads;
+        std::vector<size_t> BucketNext;
+        std::vector<size_t> BucketPrevious;
+        std::vector<unsigned char> ColumnStates;
+        /* index of a column among pivot or inactive columns */
+        std::vector<size_t> ColumnIndices;
+        std::vector<size_t> PivotRows;
+        std::vector<size_t> PivotColumns;
+        std::vector<TRing> PivotInverses;
+        std::vector<TRing> Scratch;
+        /* pivot variables in terms of inactive variables */
+        std::vector<TRing> Forms;
+        /* dense system in inactive variables */
+        std::vector<TRing> Core;
+        std::vector<TRing> Solution;
+        /* number of inactive columns in the last call */
+        size_t Inactivated = 0;
+    };
+
+    namespace StructuredDecodeImpl_
+    {
+        namespace ColumnState
+        {
+            typedef unsigned char Type;
+            constexpr Type Active = (Type)0;
+            constexpr Type Pivot = (Type)1;
+            constexpr Type Inactive = (Type)2;
+        }
+
+        /* Solves the rows of schedule for which ws.RowIncluded is true
+         * for count right-hand sides, ws.RightHandSides = TRing[rows][count].
+         * On success, ws.Solution = TRing[K][count].
+         */
+        template <typename TRing, typename TInverseFunctor>
+        bool Solve
+        (
+            StructuredDecodeSchedule<TRing> const &schedule,
+            size_t count,
+            StructuredDecodeWorkspace<TRing> &ws,
+            TInverseFunctor &inverse
+        )
+        {
+            size_t const none = (size_t)0 - (size_t)1;
+            size_t const K = schedule.K;
+            size_t const rows = schedule.Rows();
+            auto const &rowOffsets = schedule.RowOffsets;
+            auto const &columns = schedule.Columns;
+            auto const &values = schedule.Values;
+            bool const inverted = !schedule.InverseValues.empty();
+            size_t validRows = 0;
+            ws.RowDegrees.resize(rows);
+            for (size_t r = 0; r != rows; ++r)
+                if (ws.RowIncluded[r])
+                {
+                    ws.RowDegrees[r] = rowOffsets[r + 1] - rowOffsets[r];
+                    ++validRows;
+                }
+                else
+                    ws.RowDegrees[r] = none;
+            if (validRows < K)
+                return false;
+            /* ordering: a row of minimal positive degree becomes the pivot
+             * row of one of its active columns, and its other active columns
+             * are inactivated, so that the pivot rows are triangular and
+             * only the inactive columns are solved densely */
+            ws.ColumnStates.assign(K, ColumnState::Active);
+            ws.ColumnIndices.resize(K);
+            ws.PivotRows.clear();
+            ws.PivotColumns.clear();
+            ws.PivotInverses.clear();
+            /* rows of each positive degree, as doubly linked lists */
+            size_t maxDegree = 0;
+            for (size_t r = 0; r != rows; ++r)
+                if (ws.RowDegrees[r] != none && ws.RowDegrees[r] > maxDegree)
+                    maxDegree = ws.RowDegrees[r];
+            ws.BucketHeads.assign(maxDegree + 1, none);
+            ws.BucketNext.resize(rows);
+            ws.BucketPrevious.resize(rows);
+            auto link = [&ws, none](size_t r)
+            {
+                size_t &head = ws.BucketHeads[ws.RowDegrees[r]];
+                ws.BucketPrevious[r] = none;
+                ws.BucketNext[r] = head;
+                if (head != none)
+                    ws.BucketPrevious[head] = r;
+                head = r;
+            };
+            auto unlink = [&ws, none](size_t r)
+            {
+                size_t next = ws.BucketNext[r], previous = ws.BucketPrevious[r];
+                if (previous != none)
+                    ws.BucketNext[previous] = next;
+                else
+                    ws.BucketHeads[ws.RowDegrees[r]] = next;
+                if (next != none)
+                    ws.BucketPrevious[next] = previous;
+            };
+            for (size_t r = rows; r--; )
+                if (ws.RowDegrees[r] != none && ws.RowDegrees[r])
+                    link(r);
+            size_t inactivated = 0, minDegree = 1;
+            while (true)
+            {
+                while (minDegree <= maxDegree && ws.BucketHeads[minDegree] == none)
+                    ++minDegree;
+                if (minDegree > maxDegree)
+                    break;
+                size_t best = ws.BucketHeads[minDegree];
+                unlink(best);
+                ws.RowDegrees[best] = none;
+                bool pivoted = false;
+                for (size_t k = rowOffsets[best]; k != rowOffsets[best + 1]; ++k)
+                {
+                    size_t col = columns[k];
+                    if (ws.ColumnStates[col] != ColumnState::Active)
+                        continue;
+                    if (pivoted)
+                    {
+                        ws.ColumnStates[col] = ColumnState::Inactive;
+                        ws.ColumnIndices[col] = inactivated++;
+                    }
+                    else
+                    {
+                        ws.ColumnStates[col] = ColumnState::Pivot;
+                        ws.ColumnIndices[col] = ws.PivotRows.size();
+                        ws.PivotRows.push_back(best);
+                        ws.PivotColumns.push_back(col);
+                        ws.PivotInverses.push_back(
+                            inverted ? schedule.InverseValues[k] : values[k]);
+                        pivoted = true;
+                    }
+                    for (size_t j = schedule.ColumnOffsets[col];
+                        j != schedule.ColumnOffsets[col + 1]; ++j)
+                    {
+                        size_t r = schedule.ColumnRows[j];
+                        if (ws.RowDegrees[r] == none)
+                            continue;
+                        unlink(r);
+                        if (--ws.RowDegrees[r])
+                            link(r);
+                        if (ws.RowDegrees[r] < minDegree)
+                            minDegree = ws.RowDegrees[r] ? ws.RowDegrees[r] : 1;
+                    }
+                }
+            }
+            size_t pivots = ws.PivotRows.size();
+            ws.Inactivated = inactivated;
+            if (pivots + inactivated != K || validRows - pivots < inactivated)
+                return false;
+            if (!inverted)
+            {
+                ws.Scratch.resize(pivots);
+                if (!Cryptography::BatchInverse(pivots,
+                    ws.PivotInverses.begin(), ws.Scratch.begin(), inverse))
                     return false;
             }
-            auto invLeading = inverse(matrix[i * kPlus1 + i]);
-            for (size_t k = i; k <= K; ++k)
-                matrix[i * kPlus1 + k] *= invLeading;
-            if (i + 1 == K)
-                break;
-            for (size_t j = i + 1; j != validRows; ++j)
-                if ((bool)matrix[j * kPlus1 + i])
+            /* each pivot row gives x[col] + sum h[j] y[j] = g, stored as
+             * (h, g) where y are the inactive variables and g has count
+             * elements; substituting the earlier pivot variables subtracts
+             * multiples of their forms */
+            size_t width = inactivated + count;
+            ws.Forms.assign(pivots * width, TRing(0));
+            for (size_t i = 0; i != pivots; ++i)
+            {
+                TRing *form = ws.Forms.data() + i * width;
+                size_t r = ws.PivotRows[i];
+                std::copy_n(ws.RightHandSides.begin() + r * count, count, form + inactivated);
+                for (size_t k = rowOffsets[r]; k != rowOffsets[r + 1]; ++k)
+                {
+                    size_t col = columns[k];
+                    if (ws.ColumnStates[col] == ColumnState::Inactive)
+                        form[ws.ColumnIndices[col]] += values[k];
+                    else if (col != ws.PivotColumns[i])
+                        Cryptography::FieldKernels::Axpy(form, -values[k],
+                            (TRing const *)ws.Forms.data() + ws.ColumnIndices[col] * width, width);
+                }
+                Cryptography::FieldKernels::Scale(form, (TRing const *)form, ws.PivotInverses[i], width);
+            }
+            /* the remaining rows form a dense system in the inactive variables */
+            size_t coreRows = validRows - pivots;
+            ws.Core.assign(coreRows * width, TRing(0));
+            for (size_t r = 0, row = 0; r != rows; ++r)
+            {
+                if (ws.RowDegrees[r] == none)
+                    continue;
+                TRing *equation = ws.Core.data() + row++ * width;
+                std::copy_n(ws.RightHandSides.begin() + r * count, count, equation + inactivated);
+                for (size_t k = rowOffsets[r]; k != rowOffsets[r + 1]; ++k)
+                {
+                    size_t col = columns[k];
+                    if (ws.ColumnStates[col] == ColumnState::Inactive)
+                        equation[ws.ColumnIndices[col]] += values[k];
+                    else
+                        Cryptography::FieldKernels::Axpy(equation, -values[k],
+                            (TRing const *)ws.Forms.data() + ws.ColumnIndices[col] * width, width);
+                }
+            }
+            if (!DenseSolveMultipleDestructive(inactivated, count, coreRows, ws.Core.data(), inverse))
+                return false;
+            /* substitution */
+            ws.Solution.resize(K * count);
+            for (size_t col = 0; col != K; ++col)
+            {
+                size_t index = ws.ColumnIndices[col];
+                TRing *x = ws.Solution.data() + col * count;
+                if (ws.ColumnStates[col] == ColumnState::Inactive)
                 {
-                    auto leading = matrix[j * kPlus1 + i];
-                    for (size_t k = i + 1; k <= K; ++k)
-                        matrix[j * kPlus1 + k] -= leading * matrix[i * kPlus1 + k];
-                    matrix[j * kPlus1 + i] = 0;
+                    std::copy_n(ws.Core.begin() + index * width + inactivated, count, x);
+                    continue;
                 }
+                TRing const *form = ws.Forms.data() + index * width;
+                std::copy_n(form + inactivated, count, x);
+                for (size_t j = 0; j != inactivated; ++j)
+                    for (size_t q = 0; q != count; ++q)
+                        x[q] -= form[j] * ws.Core[j * width + inactivated + q];
+            }
+            return true;
         }
-        /* substitution */
-        for (size_t i = K - 1; i; --i)
-            for (size_t j = i - 1; j != (size_t)0 - (size_t)1; --j)
-                if ((bool)matrix[j * kPlus1 + i])
-                    matrix[j * kPlus1 + K] -=
-                        std::move(matrix[j * kPlus1 + i])
-                        * matrix[i * kPlus1 + K];
-        /* move the results to decoded */
-        matrix += K;
-        for (size_t i = 0; i != K; ++i, ++decoded, matrix += K + 1)
-            *decoded = std::move(*matrix);
+    }
+
+    template
+    <
+        typename TInputIt1,
+        typename TInputIt2,
+        typename TOutputIt3,
+        typename TForwardInputIt4,
+        typename TRing,
+        typename TInverseFunctor
+    >
+    bool SparseDecodeStructured
+    (
+        size_t K,
+        size_t D,
+        size_t U,
+        /* encoded = TRing[U] */
+        TInputIt1 encoded,
+        /* notNoisy = bool[U] */
+        TInputIt2 notNoisy,
+        /* decoded = TRing[K] */
+        TOutputIt3 decoded,
+        TForwardInputIt4 entries,
+        StructuredDecodeWorkspace<TRing> &workspace,
+        TInverseFunctor inverse = DefaultInverseFunctor
+    )
+    {
+        auto &ws = workspace;
+        ws.RowIncluded.resize(U);
+        ws.RightHandSides.clear();
+        for (size_t i = 0; i != U; ++i, ++encoded, ++notNoisy)
+            if ((ws.RowIncluded[i] = (bool)*notNoisy))
+                ws.RightHandSides.push_back(*encoded);
+        ws.Schedule.Build(K, D, U, entries, ws.RowIncluded.begin());
+        ws.RowIncluded.assign(ws.RightHandSides.size(), true);
+        if (!StructuredDecodeImpl_::Solve(ws.Schedule, 1, ws, inverse))
+            return false;
+        std::move(ws.Solution.begin(), ws.Solution.end(), decoded);
+        return true;
+    }
+
+    /* Same as SparseDecodeStructured, with the U rows precompiled
+     * into schedule. */
+    template
+    <
+        typename TInputIt1,
+        typename TInputIt2,
+        typename TOutputIt3,
+        typename TRing,
+        typename TInverseFunctor
+    >
+    bool SparseDecodeScheduled
+    (
+        StructuredDecodeSchedule<TRing> const &schedule,
+        /* encoded = TRing[schedule.Rows()] */
+        TInputIt1 encoded,
+        /* notNoisy = bool[schedule.Rows()] */
+        TInputIt2 notNoisy,
+        /* decoded = TRing[schedule.K] */
+        TOutputIt3 decoded,
+        StructuredDecodeWorkspace<TRing> &workspace,
+        TInverseFunctor inverse = DefaultInverseFunctor
+    )
+    {
+        auto &ws = workspace;
+        size_t rows = schedule.Rows();
+        ws.RowIncluded.resize(rows);
+        ws.RightHandSides.resize(rows);
+        for (size_t i = 0; i != rows; ++i, ++encoded, ++notNoisy)
+            if ((ws.RowIncluded[i] = (bool)*notNoisy))
+                ws.RightHandSides[i] = *encoded;
+        if (!StructuredDecodeImpl_::Solve(schedule, 1, ws, inverse))
+            return false;
+        std::move(ws.Solution.begin(), ws.Solution.end(), decoded);
+        return true;
+    }
+
+    /* Decodes count instances that share the noisy positions at once:
+     * the elimination is done once for all of them, and the vector
+     * operations run over all count right-hand sides. */
+    template
+    <
+        typename TRandomAccessInputIt1,
+        typename TInputIt2,
+        typename TRandomAccessOutputIt3,
+        typename TRing,
+        typename TInverseFunctor
+    >
+    bool SparseDecodeScheduledMultiple
+    (
+        StructuredDecodeSchedule<TRing> const &schedule,
+        size_t count,
+        /* encoded = TRing[count][schedule.Rows()] */
+        TRandomAccessInputIt1 encoded,
+        /* notNoisy = bool[schedule.Rows()], shared by all instances */
+        TInputIt2 notNoisy,
+        /* decoded = TRing[count][schedule.K] */
+        TRandomAccessOutputIt3 decoded,
+        StructuredDecodeWorkspace<TRing> &workspace,
+        TInverseFunctor inverse = DefaultInverseFunctor
+    )
+    {
+        auto &ws = workspace;
+        size_t rows = schedule.Rows();
+        size_t K = schedule.K;
+        ws.RowIncluded.resize(rows);
+        ws.RightHandSides.resize(rows * count);
+        for (size_t i = 0; i != rows; ++i, ++notNoisy)
+            if ((ws.RowIncluded[i] = (bool)*notNoisy))
+                for (size_t q = 0; q != count; ++q)
+                    ws.RightHandSides[i * count + q] = encoded[q * rows + i];
+        if (!StructuredDecodeImpl_::Solve(schedule, count, ws, inverse))
+            return false;
+        for (size_t q = 0; q != count; ++q)
+            for (size_t col = 0; col != K; ++col)
+                decoded[q * K + col] = std::move(ws.Solution[col * count + q]);
         return true;
     }
 
@@ -244,6 +923,26 @@ namespace SparseLinearCode
                 notNoisy, decoded, entries);
         }
 
+        /* Batched versions of the above for count instances, interleaved
+         * as described at SparseEncodeMultiple, without notNoisy. */
+        void EncodeBothPartsMultiple(size_t count, TRing *encoded, TRing const *decoded) const
+        {
+            auto entries = Entries.data();
+            SparseEncodeMultiple(D, U + V, count, encoded, decoded, entries);
+        }
+
+        void EncodeUpperPartMultiple(size_t count, TRing *encoded, TRing const *decoded) const
+        {
+            auto entries = Entries.data();
+            SparseEncodeMultiple(D, U, count, encoded, decoded, entries);
+        }
+
+        void EncodeLowerPartMultiple(size_t count, TRing *encoded, TRing const *decoded) const
+        {
+            auto entries = Entries.data() + D * U;
+            SparseEncodeMultiple(D, V, count, encoded, decoded, entries);
+        }
+
         template
         <
             typename TInputIt1,
@@ -270,6 +969,44 @@ namespace SparseLinearCode
             );
         }
 
+        template
+        <
+            typename TInputIt1,
+            typename TInputIt2,
+            typename TOutputIt3,
+            typename TInverseFunctor
+        >
+        bool DecodeFromUpperPartStructured
+        (
+            TInputIt1 encoded,
+            TInputIt2 notNoisy,
+            TOutputIt3 decoded,
+            StructuredDecodeWorkspace<TRing> &workspace,
+            TInverseFunctor inverse = DefaultInverseFunctor
+        ) const
+        {
+            return SparseDecodeStructured
+            (
+                K, D, U,
+                encoded, notNoisy,
+                decoded, Entries.data(),
+                workspace, inverse
+            );
+        }
+
+        /* The schedule is valid until Entries changes. */
+        template <typename TInverseFunctor>
+        bool BuildUpperPartSchedule
+        (
+            StructuredDecodeSchedule<TRing> &schedule,
+            TInverseFunctor inverse = DefaultInverseFunctor
+        ) const
+        {
+            std::vector<bool> all(U, true);
+            schedule.Build(K, D, U, Entries.data(), all.begin());
+            return schedule.Invert(inverse);
+        }
+
         template
         <
             typename TInputIt1,
@@ -330,6 +1067,127 @@ namespace SparseLinearCode
             return true;
         }
     };
+
+    /* The same code as FastSparseLinearCode for encoding, with the
+     * columns as TColumn (uint16_t suffices for K <= 65536) and the
+     * values in separate arrays. Each part is stored by blocks of rows
+     * (see Cryptography::FieldKernels::SparseBlockRows), padded with
+     * zero entries to whole blocks, the upper part first. An entry
+     * takes 4 + 2 bytes for Z<p> instead of 16.
+     */
+    template
+    <
+        typename TRing,
+        typename TColumn = uint32_t
+    >
+    struct CompactSparseLinearCode
+    {
+        size_t K;
+        size_t D;
+        size_t U;
+        size_t V;
+        std::vector<TColumn> Columns;
+        std::vector<TRing> Values;
+
+        static size_t WholeBlocks(size_t rows)
+        {
+            using Cryptography::FieldKernels::SparseBlockRows;
+            return (rows + SparseBlockRows - 1) / SparseBlockRows * SparseBlockRows;
+        }
+        /* the index of the first entry of the lower part */
+        size_t LowerPartOffset() const
+        {
+            return WholeBlocks(U) * D;
+        }
+
+        /* Returns false (and leaves this object unspecified) if the
+         * columns of code do not fit in TColumn. */
+        template <typename TAllocEntry>
+        bool Assign(FastSparseLinearCode<TRing, TAllocEntry> const &code)
+        {
+            using Cryptography::FieldKernels::SparseBlockRows;
+            if (code.K - 1 > (TColumn)-1)
+                return false;
+            K = code.K;
+            D = code.D;
+            U = code.U;
+            V = code.V;
+            Columns.assign((WholeBlocks(U) + WholeBlocks(V)) * D, 0);
+            Values.assign(Columns.size(), TRing(0));
+            auto entry = code.Entries.data();
+            for (size_t i = 0; i != U + V; ++i)
+            {
+                size_t const row = i < U ? i : i - U;
+                size_t const r = row % SparseBlockRows;
+                size_t e = (i < U ? 0 : LowerPartOffset()) + (row - r) * D + r;
+                for (size_t t = 0; t != D; ++t, ++entry, e += SparseBlockRows)
+                {
+                    Columns[e] = (TColumn)entry->Column;
+                    Values[e] = entry->Value;
+                }
+            }
+            return true;
+        }
+
+        template
+        <
+            typename TForwardInputOutputIt1,
+            typename TForwardInputIt2,
+            typename TRandomAccessInputIt3
+        >
+        void EncodeBothParts
+        (
+            /* encoded = TRing[U + V] */
+            TForwardInputOutputIt1 encoded,
+            /* notNoisy = bool[U + V] */
+            TForwardInputIt2 notNoisy,
+            TRandomAccessInputIt3 decoded
+        ) const
+        {
+            SparseEncodeCompact(D, U, encoded, notNoisy, decoded,
+                Columns.data(), Values.data());
+            SparseEncodeCompact(D, V, encoded, notNoisy, decoded,
+                Columns.data() + LowerPartOffset(), Values.data() + LowerPartOffset());
+        }
+
+        template
+        <
+            typename TForwardInputOutputIt1,
+            typename TForwardInputIt2,
+            typename TRandomAccessInputIt3
+        >
+        void EncodeUpperPart
+        (
+            /* encoded = TRing[U] */
+            TForwardInputOutputIt1 encoded,
+            /* notNoisy = bool[U] */
+            TForwardInputIt2 notNoisy,
+            TRandomAccessInputIt3 decoded
+        ) const
+        {
+            SparseEncodeCompact(D, U, encoded, notNoisy, decoded,
+                Columns.data(), Values.data());
+        }
+
+        template
+        <
+            typename TForwardInputOutputIt1,
+            typename TForwardInputIt2,
+            typename TRandomAccessInputIt3
+        >
+        void EncodeLowerPart
+        (
+            /* encoded = TRing[V] */
+            TForwardInputOutputIt1 encoded,
+            /* notNoisy = bool[V] */
+            TForwardInputIt2 notNoisy,
+            TRandomAccessInputIt3 decoded
+        ) const
+        {
+            SparseEncodeCompact(D, V, encoded, notNoisy, decoded,
+                Columns.data() + LowerPartOffset(), Values.data() + LowerPartOffset());
+        }
+    };
 }
 }
 
@@ -0,0 +1,278 @@
+#ifndef THREAD_POOL_HPP_
+#define THREAD_POOL_HPP_
+
+#include<cstddef>
+#include<deque>
+#include<memory>
+#include<vector>
+#include<mutex>
+#include<thread>
+#include<atomic>
+#include<functional>
+#include<condition_variable>
+
+namespace Concurrency
+{
+    /* A single-use countdown: Wait returns once CountDown has been
+     * called count times. */
+    struct Latch
+    {
+        explicit Latch(size_t count_)
+            : count(count_)
+        { }
+        Latch(Latch const &) = delete;
+        Latch &operator = (Latch const &) = delete;
+
+        void CountDown()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--count == 0)
+                reached.notify_all();
+        }
+
+        void Wait()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (count != 0)
+                reached.wait(lock);
+        }
+
+    private:
+        std::mutex mutex;
+        std::condition_variable reached;
+        size_t count;
+    };
+
+    /* A first-in-first-out queue between threads. Pop waits for an
+     * element, and returns false once the queue is closed and empty. */
+    template <typename T>
+    struct BlockingQueue
+    {
+        BlockingQueue()
+            : closed(false)
+        { }
+        BlockingQueue(BlockingQueue const &) = delete;
+        BlockingQueue &operator = (BlockingQueue const &) = delete;
+
+        void Push(T const &value)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                values.push_back(value);
+            }
+            pushed.notify_one();
+        }
+
+        bool Pop(T &value)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (values.empty() && !closed)
+                pushed.wait(lock);
+            if (values.empty())
+                return false;
+            value = values.front();
+            values.pop_front();
+            return true;
+        }
+
+        /* Wakes the waiting Pops; the remaining elements can still be popped. */
+        void Close()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                closed = true;
+            }
+            pushed.notify_all();
+        }
+
+    private:
+        std::mutex mutex;
+        std::condition_variable pushed;
+        std::deque<T> values;
+        bool closed;
+    };
+
+    /* A fixed set of worker threads, each with its own queue of tasks.
+     * A worker runs the most recently pushed task of its own queue and,
+     * when that is empty, steals the oldest task of another queue, so a
+     * worker blocked in a long task does not hold back the tasks queued
+     * to it. Tasks submitted from outside the pool are spread over the
+     * queues in turn; tasks submitted by a worker go to its own queue.
+     */
+    struct WorkStealingThreadPool
+    {
+        explicit WorkStealingThreadPool(size_t threads)
+            : queues(threads ? threads : 1),
+            pending(0), next(0), stopping(false)
+        {
+            workers.reserve(queues.size());
+            for (size_t i = 0; i != queues.size(); ++i)
+                workers.emplace_back(&WorkStealingThreadPool::Work, this, i);
+        }
+        WorkStealingThreadPool(WorkStealingThreadPool const &) = delete;
+        WorkStealingThreadPool &operator = (WorkStealingThreadPool const &) = delete;
+
+        /* Runs the queued tasks, then joins the workers. */
+        ~WorkStealingThreadPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(sleepMutex);
+                stopping = true;
+            }
+            wake.notify_all();
+            for (auto &worker : workers)
+                worker.join();
+        }
+
+        size_t Size() const
+        {
+            return workers.size();
+        }
+
+        /* Queues task(), then latch.CountDown(). */
+        template <typename TFunctor>
+        void Submit(TFunctor task, Latch &latch)
+        {
+            Latch *signal = &latch;
+            Push(std::function<void ()>([task, signal]() mutable
+            {
+                task();
+                signal->CountDown();
+            }));
+        }
+
+        /* Queues task() without a way to wait for it. */
+        template <typename TFunctor>
+        void Submit(TFunctor task)
+        {
+            Push(std::function<void ()>(task));
+        }
+
+        /* Runs body(i) for every i in [0, count), on up to Size() workers
+         * and the calling thread, and returns once all have run. The
+         * calling thread takes indices too, so it makes progress even when
+         * every worker is blocked in a long task, and it may be a worker
+         * itself. A worker that starts after all indices are taken returns
+         * at once. */
+        template <typename TFunctor>
+        void ParallelFor(size_t count, TFunctor const &body)
+        {
+            struct Shared
+            {
+                std::atomic<size_t> next;
+                size_t count;
+                TFunctor const *body;
+                Latch done;
+
+                Shared(size_t count_, TFunctor const *body_)
+                    : next(0), count(count_), body(body_), done(count_)
+                { }
+
+                void Run()
+                {
+                    for (size_t i; (i = next++) < count; )
+                    {
+                        (*body)(i);
+                        done.CountDown();
+                    }
+                }
+            };
+            if (count == 0)
+                return;
+            auto shared = std::make_shared<Shared>(count, &body);
+            for (size_t i = 1; i < count && i <= Size(); ++i)
+                Submit([shared]() { shared->Run(); });
+            shared->Run();
+            shared->done.Wait();
+        }
+
+    private:
+        struct Queue
+        {
+            std::mutex mutex;
+            std::deque<std::function<void ()>> tasks;
+        };
+
+        std::vector<Queue> queues;
+        std::vector<std::thread> workers;
+        std::mutex sleepMutex;
+        std::condition_variable wake;
+        /* the number of queued tasks, changed under sleepMutex */
+        size_t pending;
+        std::atomic<size_t> next;
+        bool stopping;
+
+        /* the index of the worker running on this thread, or -1 */
+        static size_t &CurrentWorker()
+        {
+            static thread_local size_t current = (size_t)-1;
+            return current;
+        }
+
+        void Push(std::function<void ()> &&task)
+        {
+            size_t i = CurrentWorker();
+            if (i >= queues.size())
+                i = next++ % queues.size();
+            {
+                std::lock_guard<std::mutex> lock(queues[i].mutex);
+                queues[i].tasks.push_back(std::move(task));
+            }
+            {
+                std::lock_guard<std::mutex> lock(sleepMutex);
+                ++pending;
+            }
+            wake.notify_one();
+        }
+
+        bool TryPop(size_t self, std::function<void ()> &task)
+        {
+            {
+                auto &own = queues[self];
+                std::lock_guard<std::mutex> lock(own.mutex);
+                if (!own.tasks.empty())
+                {
+                    task = std::move(own.tasks.back());
+                    own.tasks.pop_back();
+                    return true;
+                }
+            }
+            for (size_t k = 1; k != queues.size(); ++k)
+            {
+                auto &victim = queues[(self + k) % queues.size()];
+                std::lock_guard<std::mutex> lock(victim.mutex);
+                if (!victim.tasks.empty())
+                {
+                    task = std::move(victim.tasks.front());
+                    victim.tasks.pop_front();
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void Work(size_t self)
+        {
+            CurrentWorker() = self;
+            std::function<void ()> task;
+            for (;;)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(sleepMutex);
+                    while (pending == 0 && !stopping)
+                        wake.wait(lock);
+                    if (pending == 0)
+                        return;
+                    /* claim a task, which is in one of the queues */
+                    --pending;
+                }
+                while (!TryPop(self, task))
+                    std::this_thread::yield();
+                task();
+                task = nullptr;
+            }
+        }
+    };
+}
+
+#endif // THREAD_POOL_HPP_
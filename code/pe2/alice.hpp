@@ -1,10 +1,38 @@
+/* s, G(s), then E(r',b') and b' of each vector OLE job */
+size_t AlicePrecomputedBatchSize(ExecutionContext const *context)
+{
+    auto const &vecole = context->VectorOLE;
+    auto const &prgole = context->PseudorandomOLE;
+    return sizeof(Zp) * (prgole.K + prgole.M
+        + vecole.Jobs.size() * (vecole.U + vecole.V + vecole.W));
+}
+
 char const *InitAliceContext(ExecutionContext *context)
 {
     auto commonResult = InitCommonContext(context);
     if (commonResult)
         return commonResult;
     auto &prgole = context->PseudorandomOLE;
+    auto &vecole = context->VectorOLE;
     auto &alice = context->Alice;
+    alice.VecS.resize(prgole.K);
+    alice.VecU.resize(prgole.M);
+    alice.VecDVZ.resize(prgole.M);
+    alice.NextVecS.resize(prgole.K);
+    alice.NextVecDVZ.resize(prgole.M);
+    if (CommandLineParameters.IsOffline)
+        return nullptr;
+    if (CommandLineParameters.Precomputed)
+    {
+        auto openResult = OpenPrecomputed(context, AlicePrecomputedMagic,
+            AlicePrecomputedBatchSize(context));
+        if (openResult)
+            return openResult;
+        for (auto vec : { &alice.VecOleMasks, &alice.NextVecOleMasks })
+            vec->resize(vecole.Jobs.size() * (vecole.U + vecole.V));
+        for (auto vec : { &alice.VecOleBp, &alice.NextVecOleBp })
+            vec->resize(vecole.Jobs.size() * vecole.W);
+    }
     alice.VecX.resize(prgole.M);
     FILE *fp = fopen(CommandLineParameters.AliceX, "r");
     if (!fp)
@@ -16,9 +44,6 @@ char const *InitAliceContext(ExecutionContext *context)
     fclose(fp);
     if (!loadResult)
         return "x: Could not load x from the file.";
-    alice.VecS.resize(prgole.K);
-    alice.VecU.resize(prgole.M);
-    alice.VecDVZ.resize(prgole.M);
     return nullptr;
 }
 
@@ -58,8 +83,7 @@ struct AliceReceivesBobsKeys
     {
         auto &comm = context->Communication;
         auto &prgole = context->PseudorandomOLE;
-        auto bobConfig = prgole.Config.BobEncoding.data();
-        auto bobKeys = prgole.Keys.BobEncoding.data();
+        auto &bobKeys = prgole.Keys.BobEncoding;
         SocketWrappers::SocketConsumer pipe = comm.Socket1.RawValue();
         uint64_t payload;
         if (!pipe.Receive(8, &payload))
@@ -72,13 +96,10 @@ struct AliceReceivesBobsKeys
             comm.Error1 = "Bad hello message. Misaligned stream?";
             return;
         }
-        for (size_t i = 0, isz = 2 * prgole.M; i != isz; ++i)
+        if (!pipe.Receive(sizeof(Zp) * bobKeys.size(), bobKeys.data()))
         {
-            if (!pipe.Receive(sizeof(Zp) * *bobConfig++, (bobKeys++)->data()))
-            {
-                comm.Error1 = "Could not receive Bob's keys.";
-                return;
-            }
+            comm.Error1 = "Could not receive Bob's keys.";
+            return;
         }
         if (!pipe.Receive(8, &payload))
         {
@@ -93,6 +114,72 @@ struct AliceReceivesBobsKeys
     }
 };
 
+/* Samples r' and b' into VectorOLE.VecR and vecBp, and adds E(r',b')
+ * to vecE. */
+void AliceAddsVecOleMask(ExecutionContext *context, RNG &seeds, Zp *vecE, Zp *vecBp)
+{
+    auto &vecole = context->VectorOLE;
+    auto const vecR = vecole.VecR.data();
+    auto const itNeverNoisy = vecole.ItNeverNoisy;
+    auto distRp = MakeUZp(), distBp = MakeUZp();
+    RNG nextRp, nextBp;
+    nextRp.Seed(seeds);
+    nextBp.Seed(seeds);
+    SampleRandomVector(vecR, vecR + vecole.K, nextRp, distRp)();
+    SampleRandomVector(vecBp, vecBp + vecole.W, nextBp, distBp)();
+    vecole.CompactSparseCode.EncodeBothParts(vecE, itNeverNoisy, vecR);
+    vecole.CompactLubyCode.EncodeScheduled(vecole.LubyEncodeSchedule,
+        vecE + vecole.U, itNeverNoisy, vecBp);
+}
+
+/* The state shared by the two halves of Alice's vector OLEs. */
+struct AliceVecOlePipeline
+{
+    /* the slots whose E(xr+r',xa+b') is ready, in order */
+    BlockingQueue<size_t> Replies;
+    /* the slots whose E(xr+r',xa+b') has been sent, in order */
+    BlockingQueue<size_t> Sent;
+    char const *SendError;
+    AliceVecOlePipeline()
+        : SendError(nullptr)
+    { }
+};
+
+struct AliceSendsVecOleReplies
+{
+    ExecutionContext *context;
+    AliceVecOlePipeline *pipeline;
+
+    AliceSendsVecOleReplies(ExecutionContext *context_, AliceVecOlePipeline *pipeline_)
+        : context(context_), pipeline(pipeline_)
+    { }
+
+    void operator () () const
+    {
+        auto &comm = context->Communication;
+        auto &vecole = context->VectorOLE;
+        auto &slots = vecole.Slots;
+        auto const UV = vecole.U + vecole.V;
+        SocketWrappers::SocketConsumer pipe = comm.Socket2.RawValue();
+        size_t slotIndex;
+        while (pipeline->Replies.Pop(slotIndex))
+        {
+            auto const &slot = slots[slotIndex];
+            VectorOLEHeader const header{ ReplyVecOleMessage, slot.Sequence, slot.Job };
+            /* send E(xr+r',xa+b') to Bob with OT emulation */
+            if (!pipe.Send(sizeof(header), &header)
+                || !pipe.Send(sizeof(Zp) * UV, slot.VecE.data())
+                || !pipe.Send(sizeof(Zp) * UV, slot.VecE.data()))
+            {
+                pipeline->SendError = "Could not send E(xr+r', xa+b') to Bob.";
+                break;
+            }
+            pipeline->Sent.Push(slotIndex);
+        }
+        pipeline->Sent.Close();
+    }
+};
+
 struct AliceDoesVecOle
 {
     ExecutionContext *context;
@@ -108,21 +195,13 @@ struct AliceDoesVecOle
         auto &vecole = context->VectorOLE;
         auto &alice = context->Alice;
         auto &stat = context->Statistics;
-        auto aliceConfig = prgole.Config.AliceEncoding.data();
-        auto aliceKeys = prgole.Keys.AliceEncoding.data();
+        auto const &jobs = vecole.Jobs;
+        auto &slots = vecole.Slots;
         auto const *vecS = alice.VecS.data();
-        auto const vecR = vecole.VecR.data();
         auto const vecM = vecole.VecM.data();
-        auto const vecMTmp = vecole.VecMTmp.data();
-        auto const vecE = vecole.VecE.data();
-        auto const itNeverNoisy = vecole.ItNeverNoisy;
         auto const U = vecole.U;
         auto const V = vecole.V;
         auto const W = vecole.W;
-        auto const prgoleK = prgole.K;
-        auto const vecoleK = vecole.K;
-        auto &sparse = vecole.SparseCode;
-        auto &luby = vecole.LubyCode;
         SocketWrappers::SocketConsumer pipe = comm.Socket2.RawValue();
         uint64_t payload;
         if (!pipe.Receive(8, &payload))
@@ -135,84 +214,135 @@ struct AliceDoesVecOle
             comm.Error2 = "Bad hello message. Misaligned stream?";
             return;
         }
+        /* Bob keeps at most this many vector OLEs in flight */
+        uint64_t window;
+        if (!pipe.Receive(8, &window))
+        {
+            comm.Error2 = "Could not receive the vector OLE window.";
+            return;
+        }
+        if (window < 1 || window > MaxVectorOLEWindow)
+        {
+            comm.Error2 = "Bad vector OLE window. Misaligned stream?";
+            return;
+        }
+        if (slots.size() != window)
+        {
+            slots.resize(window);
+            for (auto &slot : slots)
+            {
+                slot.VecE.resize(U + V);
+                slot.VecMTmp.resize(W);
+            }
+        }
         std::random_device randomSource;
-        for (size_t i = 0; i != prgoleK; ++i)
+        RNG seeds;
+        seeds.Seed(randomSource);
+        /* the first attempt of each job uses the precomputed material */
+        std::vector<bool> attempted(jobs.size(), context->Precomputed.File == nullptr);
+        AliceVecOlePipeline pipeline;
+        Latch sent{1};
+        context->Workers.Submit(AliceSendsVecOleReplies{context, &pipeline}, sent);
+        char const *error = nullptr;
+        uint64_t nextSequence = 0;
+        size_t remaining = jobs.size();
+        for (;;)
         {
-            auto const s = *vecS++;
-            auto aliceEncoding = (aliceKeys++)->data();
-            for (size_t j = 0, jsz = *aliceConfig++; j != jsz; )
+            VectorOLEHeader header;
+            if (!pipe.Receive(sizeof(header), &header))
             {
-                /* sample r' and b' */
-                auto distRp = MakeUZp(), distBp = MakeUZp();
-                RNG nextRp{randomSource()}, nextBp{randomSource()};
-                auto sampRp = SampleRandomVector(vecR, vecR + vecoleK, nextRp, distRp);
-                auto sampBp = SampleRandomVector(vecMTmp, vecMTmp + W, nextBp, distBp);
-                std::thread randRp{sampRp};
-                std::thread randBp{sampBp};
+                error = "Could not receive a vector OLE message from Bob.";
+                break;
+            }
+            if (header.Message == ByeByeMessage)
+            {
+                if (remaining)
+                    error = "Bob said bye-bye before all vector OLEs succeeded.";
+                break;
+            }
+            if (header.Job >= jobs.size())
+            {
+                error = "Bad vector OLE job. Misaligned stream?";
+                break;
+            }
+            auto const &job = jobs[header.Job];
+            if (header.Message == EncodedVecOleMessage)
+            {
+                /* Bob has the outcome of the vector OLE that used this
+                 * slot before, since it had to free a slot of his */
+                if (header.Sequence != nextSequence++)
+                {
+                    error = "Bad vector OLE sequence number. Misaligned stream?";
+                    break;
+                }
+                auto &slot = slots[header.Sequence % window];
+                auto const vecE = slot.VecE.data();
+                auto const vecMTmp = slot.VecMTmp.data();
+                slot.Sequence = header.Sequence;
+                slot.Job = header.Job;
                 /* receive E(r,a)+e from Bob */
                 if (!pipe.Receive(sizeof(Zp) * (U + V), vecE))
                 {
-                    comm.Error2 = "Could not receive E(r,a)+e from Bob.";
-                    return;
+                    error = "Could not receive E(r,a)+e from Bob.";
+                    break;
                 }
                 /* compute E(xr,xa) */
-                for (auto k = U + V; k; vecE[--k] *= s)
-                    ;
+                FieldKernels::Scale(vecE, vecE, vecS[job.Seed], U + V);
                 /* compute E(xr+r',xa+b') */
-                randRp.join();
-                sparse.EncodeBothParts(vecE, itNeverNoisy, vecR);
-                randBp.join();
-                luby.Encode(vecE + U, itNeverNoisy, vecMTmp);
-                /* send E(xr+r',xa+b') to Bob with OT emulation */
-                if (!pipe.Send(sizeof(Zp) * (U + V), vecE))
-                {
-                    comm.Error2 = "Could not emulate OT of E(xr+r', xa+b') with Bob.";
-                    return;
-                }
-                if (!pipe.Send(sizeof(Zp) * (U + V), vecE))
+                if (attempted[header.Job])
+                    AliceAddsVecOleMask(context, seeds, vecE, vecMTmp);
+                else
                 {
-                    comm.Error2 = "Could not send E(xr+r', xa+b') to Bob.";
-                    return;
+                    FieldKernels::Add(vecE, vecE, alice.VecOleMasks.data() + header.Job * (U + V), U + V);
+                    memcpy(vecMTmp, alice.VecOleBp.data() + header.Job * W, sizeof(Zp) * W);
+                    attempted[header.Job] = true;
                 }
-                /* receive whether this vector OLE is successful*/
-                if (!pipe.Receive(8, &payload))
-                {
-                    comm.Error2 = "Could not receive whether Bob successfully decoded the result.";
-                    return;
-                }
-                /* if unsuccessful, retry */
-                if (payload == FailedVecOleMessage)
-                {
-                    ++stat.UnsuccessfulVectorOLE;
-                    continue;
-                }
-                if (payload != SuccessfulVecOleMessage)
-                {
-                    comm.Error2 = "Bad success/fail vector OLE message. Misaligned stream?";
-                    return;
-                }
-                /* if successful, receive b+xa+b' from Bob */
-                if (!pipe.Receive(sizeof(Zp) * W, vecM))
-                {
-                    comm.Error2 = "Could not receive b+xa+b' from Bob.";
-                    return;
-                }
-                /* compute xa+b */
-                for (size_t k = 0; j != jsz && k != W; ++j, ++k)
-                    *aliceEncoding++ = vecM[k] - vecMTmp[k];
-                ++stat.SuccessfulVectorOLE;
+                pipeline.Replies.Push(header.Sequence % window);
+                continue;
             }
+            /* the outcomes arrive in the order of the replies */
+            size_t slotIndex;
+            if (!pipeline.Sent.Pop(slotIndex))
+            {
+                error = pipeline.SendError;
+                break;
+            }
+            auto const &slot = slots[slotIndex];
+            if (header.Sequence != slot.Sequence || header.Job != slot.Job)
+            {
+                error = "Bad vector OLE sequence number. Misaligned stream?";
+                break;
+            }
+            /* if unsuccessful, Bob retries with another sequence number */
+            if (header.Message == FailedVecOleMessage)
+            {
+                ++stat.UnsuccessfulVectorOLE;
+                continue;
+            }
+            if (header.Message != SuccessfulVecOleMessage)
+            {
+                error = "Bad vector OLE message. Misaligned stream?";
+                break;
+            }
+            /* if successful, receive b+xa+b' from Bob */
+            if (!pipe.Receive(sizeof(Zp) * W, vecM))
+            {
+                error = "Could not receive b+xa+b' from Bob.";
+                break;
+            }
+            /* compute xa+b */
+            FieldKernels::Subtract(prgole.Keys.AliceEncoding.data()
+                + prgole.Keys.AliceOffset[job.Seed] + job.Offset,
+                vecM, slot.VecMTmp.data(), job.Count);
+            ++stat.SuccessfulVectorOLE;
+            --remaining;
         }
-        if (!pipe.Receive(8, &payload))
-        {
-            comm.Error2 = "Could not receive bye-bye message.";
-            return;
-        }
-        if (payload != ByeByeMessage)
-        {
-            comm.Error2 = "Bad bye-bye message. Misaligned stream?";
-            return;
-        }
+        pipeline.Replies.Close();
+        sent.Wait();
+        if (!error)
+            error = pipeline.SendError;
+        if (error)
+            comm.Error2 = error;
     }
 };
 
@@ -230,16 +360,97 @@ struct AliceUngarbles
         auto &prgole = context->PseudorandomOLE;
         auto &alice = context->Alice;
         auto vecU = alice.VecU.data();
-        auto &circuit = prgole.Circuit;
-        auto &configSurrogate = prgole.ConfigSurrogate;
         auto &keys = prgole.Keys;
-        std::thread threadReceiveBobsKeys{AliceReceivesBobsKeys{context}};
+        Latch receivedBobsKeys{1};
+        context->Workers.Submit(AliceReceivesBobsKeys{context}, receivedBobsKeys);
         AliceDoesVecOle{context}();
-        prgole.ConfigSurrogate.ResetPreserveConfiguration();
-        threadReceiveBobsKeys.join();
+        receivedBobsKeys.Wait();
         if (comm.HasErrors())
             return;
-        Garbled2::Ungarble(circuit, configSurrogate, keys, vecU);
+        Garbled2::ParallelUngarble(prgole.Program, keys, vecU, context->Workers);
+    }
+};
+
+/* Samples s and computes G(s) of a batch into NextVecS and NextVecDVZ. */
+void AliceSamplesSeed(ExecutionContext *context, RNG const &batchSeeds)
+{
+    auto &prgole = context->PseudorandomOLE;
+    auto const &gg = prgole.GoldreichFunc;
+    auto &alice = context->Alice;
+    auto const K = prgole.K;
+    auto const M = prgole.M;
+    auto const vecS = alice.NextVecS.data();
+    auto const vecDVZ = alice.NextVecDVZ.data();
+    auto const addArity = gg.A;
+    auto const multArity = gg.B;
+    auto const *storage = gg.Storage.data();
+    RNG nextS = batchSeeds;
+    auto distS = MakeUZp();
+    SampleRandomVector(vecS, vecS + K, nextS, distS)();
+    /* compute G(s) */
+    for (size_t i = 0; i != M; ++i)
+    {
+        Zp sum = 0;
+        Zp prod = 1;
+        for (auto j = addArity; j--; sum += vecS[*storage++])
+            ;
+        for (auto j = multArity; j--; prod *= vecS[*storage++])
+            ;
+        vecDVZ[i] = sum + prod;
+    }
+}
+
+/* Samples s and computes D=x-G(s) of a batch into NextVecS and
+ * NextVecDVZ. */
+struct AlicePreparesBatch
+{
+    ExecutionContext *context;
+    RNG batchSeeds;
+
+    AlicePreparesBatch(ExecutionContext *context_, RNG const &batchSeeds_)
+        : context(context_), batchSeeds(batchSeeds_)
+    { }
+
+    void operator () () const
+    {
+        auto &alice = context->Alice;
+        AliceSamplesSeed(context, batchSeeds);
+        FieldKernels::Subtract(alice.NextVecDVZ.data(), alice.VecX.data(),
+            alice.NextVecDVZ.data(), alice.NextVecDVZ.size());
+    }
+};
+
+/* Reads s, G(s), and E(r',b') and b' of each vector OLE job of a batch
+ * into the Next buffers, and computes D=x-G(s). */
+struct AliceLoadsBatch
+{
+    ExecutionContext *context;
+
+    AliceLoadsBatch(ExecutionContext *context_)
+        : context(context_)
+    { }
+
+    void operator () () const
+    {
+        auto &prgole = context->PseudorandomOLE;
+        auto &vecole = context->VectorOLE;
+        auto &alice = context->Alice;
+        auto &precomputed = context->Precomputed;
+        auto const fp = precomputed.File;
+        auto const UV = vecole.U + vecole.V;
+        auto const W = vecole.W;
+        bool good = ReadZp(fp, alice.NextVecS.data(), prgole.K)
+            && ReadZp(fp, alice.NextVecDVZ.data(), prgole.M);
+        for (size_t j = 0; good && j != vecole.Jobs.size(); ++j)
+            good = ReadZp(fp, alice.NextVecOleMasks.data() + j * UV, UV)
+                && ReadZp(fp, alice.NextVecOleBp.data() + j * W, W);
+        if (!good)
+        {
+            precomputed.Error = "file: Could not read the material of a batch.";
+            return;
+        }
+        FieldKernels::Subtract(alice.NextVecDVZ.data(), alice.VecX.data(),
+            alice.NextVecDVZ.data(), prgole.M);
     }
 };
 
@@ -255,32 +466,15 @@ struct AliceEliminatesCryptoBlinding
     {
         auto &comm = context->Communication;
         auto &prgole = context->PseudorandomOLE;
-        auto const &gg = prgole.GoldreichFunc;
         auto &alice = context->Alice;
         auto const M = prgole.M;
-        auto const vecX = alice.VecX.data();
-        auto const vecS = alice.VecS.data();
         auto const vecDVZ = alice.VecDVZ.data();
-        auto const addArity = gg.A;
-        auto const multArity = gg.B;
-        auto const *storage = gg.Storage.data();
         SocketWrappers::SocketConsumer pipe = comm.Socket3.RawValue();
         if (!pipe.Send(8, &HelloMessage))
         {
             comm.Error3 = "Could not send hello message.";
             return;
         }
-        /* compute D=x-G(s) */
-        for (size_t i = 0; i != M; ++i)
-        {
-            Zp sum = 0;
-            Zp prod = 1;
-            for (auto j = addArity; j--; sum += vecS[*storage++])
-                ;
-            for (auto j = multArity; j--; prod *= vecS[*storage++])
-                ;
-            vecDVZ[i] = vecX[i] - sum - prod;
-        }
         /* send D to Bob */
         if (!pipe.Send(sizeof(Zp) * M, vecDVZ))
         {
@@ -324,10 +518,11 @@ int PlayAlice()
     AliceConnectsSocket acs1{CommandLineParameters.Port1, &comm.Socket1};
     AliceConnectsSocket acs2{CommandLineParameters.Port2, &comm.Socket2};
     AliceConnectsSocket acs3{CommandLineParameters.Port3, &comm.Socket3};
-    std::thread acst1{acs1};
-    std::thread acst2{acs2};
-    std::thread acst3{acs3};
-    acst1.join(); acst2.join(); acst3.join();
+    Latch connected{3};
+    context.Workers.Submit(acs1, connected);
+    context.Workers.Submit(acs2, connected);
+    context.Workers.Submit(acs3, connected);
+    connected.Wait();
     if (!comm.Socket1.IsValid()
         || !comm.Socket2.IsValid()
         || !comm.Socket3.IsValid())
@@ -337,28 +532,53 @@ int PlayAlice()
     }
     PrintHelpfulInformation("Connected to Bob.");
     PrintHelpfulInformation("Executing batch OLEs.");
-    auto const K = prgole.K;
     auto const M = prgole.M;
-    auto const vecS = alice.VecS.data();
-    auto const vecDVZ = alice.VecDVZ.data();
     auto const vecU = alice.VecU.data();
     std::random_device randomSource;
+    RNG seeds;
+    seeds.Seed(randomSource);
+    RNG batchSeeds;
+    auto const precomputed = (context.Precomputed.File != nullptr);
     auto startTime = Clock::now();
+    batchSeeds.Seed(seeds);
+    if (precomputed)
+        AliceLoadsBatch{&context}();
+    else
+        AlicePreparesBatch{&context, batchSeeds}();
     for (auto i = CommandLineParameters.ExecutionCount; i--; )
     {
-        RNG nextS{randomSource()};
-        auto distS = MakeUZp();
-        SampleRandomVector(vecS, vecS + K, nextS, distS)();
-        std::thread unblinding{AliceEliminatesCryptoBlinding{&context}};
+        if (context.Precomputed.Error)
+        {
+            PrintHelpfulInformation(context.Precomputed.Error);
+            return -13;
+        }
+        alice.VecS.swap(alice.NextVecS);
+        alice.VecDVZ.swap(alice.NextVecDVZ);
+        alice.VecOleMasks.swap(alice.NextVecOleMasks);
+        alice.VecOleBp.swap(alice.NextVecOleBp);
+        /* prepare or load the next batch while this one is on the wire */
+        Latch prepared{1};
+        if (!i)
+            prepared.CountDown();
+        else if (precomputed)
+            context.Workers.Submit(AliceLoadsBatch{&context}, prepared);
+        else
+        {
+            batchSeeds.Seed(seeds);
+            context.Workers.Submit(AlicePreparesBatch{&context, batchSeeds}, prepared);
+        }
+        Latch unblinding{1};
+        context.Workers.Submit(AliceEliminatesCryptoBlinding{&context}, unblinding);
         AliceUngarbles{&context}();
-        unblinding.join();
+        unblinding.Wait();
+        prepared.Wait();
         if (comm.HasErrors())
         {
             comm.PrintErrors();
             return -12;
         }
-        for (size_t j = 0; j != M; ++j)
-            vecDVZ[j] += vecU[j];
+        auto const vecDVZ = alice.VecDVZ.data();
+        FieldKernels::Add(vecDVZ, vecDVZ, vecU, M);
     }
     auto endTime = Clock::now();
     PrintHelpfulInformation("Finished executing batch OLEs.");
@@ -371,3 +591,54 @@ int PlayAlice()
     PrintHelpfulInformation("Done.");
     return 0;
 }
+
+int PrecomputeAlice()
+{
+    ExecutionContext context;
+    auto &prgole = context.PseudorandomOLE;
+    auto &vecole = context.VectorOLE;
+    auto &alice = context.Alice;
+    auto prepareResult = InitAliceContext(&context);
+    if (!prepareResult)
+        prepareResult = CreatePrecomputed(&context, AlicePrecomputedMagic);
+    if (prepareResult)
+    {
+        PrintHelpfulInformation(prepareResult);
+        return -10;
+    }
+    PrintHelpfulInformation("Precomputing batches.");
+    auto const fp = context.Precomputed.File;
+    auto const UV = vecole.U + vecole.V;
+    auto const W = vecole.W;
+    std::vector<Zp> vecMask(UV), vecBp(W);
+    std::random_device randomSource;
+    RNG seeds;
+    seeds.Seed(randomSource);
+    RNG batchSeeds;
+    for (auto i = CommandLineParameters.ExecutionCount; i--; )
+    {
+        batchSeeds.Seed(seeds);
+        AliceSamplesSeed(&context, batchSeeds);
+        bool good = WriteZp(fp, alice.NextVecS.data(), prgole.K)
+            && WriteZp(fp, alice.NextVecDVZ.data(), prgole.M);
+        for (size_t j = 0; good && j != vecole.Jobs.size(); ++j)
+        {
+            std::fill(vecMask.begin(), vecMask.end(), Zp());
+            AliceAddsVecOleMask(&context, seeds, vecMask.data(), vecBp.data());
+            good = WriteZp(fp, vecMask.data(), UV)
+                && WriteZp(fp, vecBp.data(), W);
+        }
+        if (!good)
+        {
+            PrintHelpfulInformation("file: Could not write the material of a batch.");
+            return -13;
+        }
+    }
+    if (fflush(fp) != 0)
+    {
+        PrintHelpfulInformation("file: Could not write the material of a batch.");
+        return -13;
+    }
+    PrintHelpfulInformation("Done.");
+    return 0;
+}
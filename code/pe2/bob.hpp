@@ -1,3 +1,16 @@
+/* c, Bob's and Alice's coefficients and intercepts (Alice's
+ * coefficients are for retrying failed jobs), then E(r,a)+e and the
+ * packed noise mask of each vector OLE job */
+size_t BobPrecomputedBatchSize(ExecutionContext const *context)
+{
+    auto const &vecole = context->VectorOLE;
+    auto const &stat = context->Statistics;
+    return sizeof(Zp) * (context->PseudorandomOLE.M
+        + 2 * (stat.BobKeyLength + stat.AliceKeyLength)
+        + vecole.Jobs.size() * (vecole.U + vecole.V))
+        + vecole.Jobs.size() * PackedNotNoisySize(vecole.U + vecole.V);
+}
+
 char const *InitBobContext(ExecutionContext *context)
 {
     auto commonResult = InitCommonContext(context);
@@ -6,6 +19,31 @@ char const *InitBobContext(ExecutionContext *context)
     auto &prgole = context->PseudorandomOLE;
     auto &vecole = context->VectorOLE;
     auto &bob = context->Bob;
+    bob.VecC.resize(prgole.M);
+    bob.NextVecC.resize(prgole.M);
+    prgole.NextKeyPairs.ApplyConfiguration(prgole.Config);
+    vecole.Slots.resize(CommandLineParameters.VectorOLEWindow);
+    for (auto &slot : vecole.Slots)
+    {
+        slot.VecR.resize(vecole.K);
+        slot.VecE.resize(vecole.U + vecole.V);
+        slot.VecM.resize(vecole.W);
+        slot.VecMTmp.resize(vecole.W);
+        slot.VecNotNoisy.resize(vecole.U + vecole.V);
+    }
+    if (CommandLineParameters.IsOffline)
+        return nullptr;
+    if (CommandLineParameters.Precomputed)
+    {
+        auto openResult = OpenPrecomputed(context, BobPrecomputedMagic,
+            BobPrecomputedBatchSize(context));
+        if (openResult)
+            return openResult;
+        for (auto vec : { &bob.VecOleEncodings, &bob.NextVecOleEncodings })
+            vec->resize(vecole.Jobs.size() * (vecole.U + vecole.V));
+        for (auto vec : { &bob.VecOleNotNoisy, &bob.NextVecOleNotNoisy })
+            vec->resize(vecole.Jobs.size() * PackedNotNoisySize(vecole.U + vecole.V));
+    }
     bob.VecA.resize(prgole.M);
     bob.VecB.resize(prgole.M);
     FILE *fp = fopen(CommandLineParameters.BobA, "r");
@@ -26,14 +64,117 @@ char const *InitBobContext(ExecutionContext *context)
     fclose(fp);
     if (!loadResult)
         return "b: Could not load b from the file.";
-    bob.VecC.resize(prgole.M);
     bob.VecDV.resize(prgole.M);
-    /* ~2M keys are sent in a batch to improve performance. */
-    bob.VecBuf.resize(2097152);
-    bob.VecGE.resize((vecole.U + vecole.V - vecole.U / 4 - vecole.V / 4) * (vecole.K + 1));
+    if (!vecole.SparseCode.BuildUpperPartSchedule(bob.SparseSchedule, InverseZp))
+        return "Could not build the decoding schedule of the sparse code.";
+    vecole.CompactLubyCode.BuildPeelingIndex(bob.LubyIndex);
     return nullptr;
 }
 
+/* Samples c and garbles a batch into NextVecC and NextKeyPairs. */
+struct BobGarblesBatch
+{
+    ExecutionContext *context;
+    RNG batchSeeds;
+
+    BobGarblesBatch(ExecutionContext *context_, RNG const &batchSeeds_)
+        : context(context_), batchSeeds(batchSeeds_)
+    { }
+
+    void operator () () const
+    {
+        auto &prgole = context->PseudorandomOLE;
+        auto const vecC = context->Bob.NextVecC.data();
+        RNG seeds = batchSeeds;
+        RNG nextC;
+        /* one generator for each range of outputs ParallelGarble may use */
+        std::vector<RNG> nextGC(context->Workers.Size() + 1);
+        nextC.Seed(seeds);
+        for (auto &next : nextGC)
+            next.Seed(seeds);
+        auto distC = MakeUZp(); auto distGC = MakeUZp();
+        SampleRandomVector(vecC, vecC + prgole.M, nextC, distC)();
+        Garbled2::ParallelGarble(prgole.Program, prgole.NextKeyPairs,
+            nextGC.data(), context->Workers, distGC);
+    }
+};
+
+/* Reads c, the key pairs, and E(r,a)+e and the noise mask of each
+ * vector OLE job of a batch into the Next buffers. */
+struct BobLoadsBatch
+{
+    ExecutionContext *context;
+
+    BobLoadsBatch(ExecutionContext *context_)
+        : context(context_)
+    { }
+
+    void operator () () const
+    {
+        auto &prgole = context->PseudorandomOLE;
+        auto &vecole = context->VectorOLE;
+        auto &bob = context->Bob;
+        auto &keypairs = prgole.NextKeyPairs;
+        auto &precomputed = context->Precomputed;
+        auto const fp = precomputed.File;
+        auto const UV = vecole.U + vecole.V;
+        auto const packedSize = PackedNotNoisySize(UV);
+        bool good = ReadZp(fp, bob.NextVecC.data(), prgole.M);
+        for (auto vec : { &keypairs.BobCoefficient, &keypairs.BobIntercept,
+            &keypairs.AliceCoefficient, &keypairs.AliceIntercept })
+            good = good && ReadZp(fp, vec->data(), vec->size());
+        for (size_t j = 0; good && j != vecole.Jobs.size(); ++j)
+            good = ReadZp(fp, bob.NextVecOleEncodings.data() + j * UV, UV)
+                && fread(bob.NextVecOleNotNoisy.data() + j * packedSize, 1, packedSize, fp) == packedSize;
+        if (!good)
+            precomputed.Error = "file: Could not read the material of a batch.";
+    }
+};
+
+/* Samples r and e, and computes E(r,a)+e of a job into slot.VecE and
+ * slot.VecNotNoisy, with slot.VecR and slot.VecM as scratch. */
+void BobEncodesVecOle(ExecutionContext *context,
+    Garbled2::FlatKeyPairs<Zp> const &keypairs, size_t jobIndex,
+    RNG &seeds, ExecutionContext::VectorOLETag::SlotTag &slot)
+{
+    auto const &vecole = context->VectorOLE;
+    auto const &job = vecole.Jobs[jobIndex];
+    auto const aliceCoef = keypairs.AliceCoefficient.data()
+        + keypairs.AliceOffset[job.Seed] + job.Offset;
+    auto const vecoleK = vecole.K;
+    auto const U = vecole.U;
+    auto const V = vecole.V;
+    auto const W = vecole.W;
+    auto const vecR = slot.VecR.data();
+    auto const vecE = slot.VecE.data();
+    auto const vecM = slot.VecM.data();
+    auto &vecNotNoisy = slot.VecNotNoisy;
+    auto distR = MakeUZp();
+    /* sample r */
+    RNG nextR;
+    nextR.Seed(seeds);
+    SampleRandomVector(vecR, vecR + vecoleK, nextR, distR)();
+    /* sample e */
+    vecNotNoisy.assign(U + V, true);
+    EraseSubsetExact(vecNotNoisy.begin(), vecNotNoisy.begin() + U,
+        U / 4, nextR);
+    EraseSubsetExact(vecNotNoisy.begin() + U, vecNotNoisy.begin() + U + V,
+        V / 4, nextR);
+    /* prepare for computing E(r,a)+e */
+    memset(vecE, 0, sizeof(Zp) * (U + V));
+    memcpy(vecM, aliceCoef, sizeof(Zp) * job.Count);
+    /* reset unused part of vecM to prevent accidental leakage */
+    memset(vecM + job.Count, 0, sizeof(Zp) * (W - job.Count));
+    /* compute E(r,a) */
+    vecole.CompactSparseCode.EncodeBothParts(vecE, vecNotNoisy.begin(), vecR);
+    vecole.CompactLubyCode.EncodeScheduled(vecole.LubyEncodeSchedule,
+        vecE + U, vecNotNoisy.begin() + U, vecM);
+    /* compute E(r,a)+e */
+    for (size_t i = 0; i != U + V; ++i)
+        if (!vecNotNoisy[i])
+            vecE[i] = distR(nextR);
+}
+
 struct BobConnectsSocket
 {
     char const *server;
@@ -59,6 +200,8 @@ struct BobConnectsSocket
     }
 };
 
+/* Computes Bob's keys a * coefficient + intercept in place of the
+ * intercepts of KeyPairs, and sends each run of them from there. */
 struct BobSendsBobsKeys
 {
     ExecutionContext *context;
@@ -73,14 +216,11 @@ struct BobSendsBobsKeys
         auto &prgole = context->PseudorandomOLE;
         auto &bob = context->Bob;
         auto const M = prgole.M;
-        auto bobConfig = prgole.Config.BobEncoding.data();
-        auto bobCoef = prgole.KeyPairs.BobCoefficient.data();
-        auto bobInte = prgole.KeyPairs.BobIntercept.data();
+        auto const bobOffset = prgole.KeyPairs.BobOffset.data();
+        auto const bobCoef = prgole.KeyPairs.BobCoefficient.data();
+        auto const bobKeys = prgole.KeyPairs.BobIntercept.data();
         auto vecs = { bob.VecA.data(), bob.VecC.data() };
-        auto const buffer = bob.VecBuf.data();
-        auto const bufferSize = bob.VecBuf.size();
-        auto bufferCurrent = buffer;
-        auto bufferRemaining = bufferSize;
+        size_t input = 0, sent = 0;
         SocketWrappers::SocketConsumer pipe = comm.Socket1.RawValue();
         if (!pipe.Send(8, &HelloMessage))
         {
@@ -89,30 +229,25 @@ struct BobSendsBobsKeys
         }
         for (auto vec : vecs)
         {
-            for (auto i = vec, iend = vec + M; i != iend; ++i)
+            for (auto i = vec, iend = vec + M; i != iend; ++i, ++input)
             {
-                auto const *coef = (bobCoef++)->data();
-                auto const *inte = (bobInte++)->data();
-                for (size_t j = 0, jsz = *bobConfig++; j != jsz; ++j)
+                auto const begin = bobOffset[input];
+                auto const end = bobOffset[input + 1];
+                FieldKernels::Axpy(bobKeys + begin, *i, bobCoef + begin, end - begin);
+                /* send keys in batch */
+                if (end - sent >= BobKeysPerSend)
                 {
-                    /* send keys in batch */
-                    if (!bufferRemaining)
+                    if (!pipe.Send(sizeof(Zp) * (end - sent), bobKeys + sent))
                     {
-                        if (!pipe.Send(sizeof(Zp) * bufferSize, buffer))
-                        {
-                            comm.Error1 = "Could not send batch of Bob's keys.";
-                            return;
-                        }
-                        bufferCurrent = buffer;
-                        bufferRemaining = bufferSize;
+                        comm.Error1 = "Could not send batch of Bob's keys.";
+                        return;
                     }
-                    *bufferCurrent++ = *coef++ * *i + *inte++;
-                    --bufferRemaining;
+                    sent = end;
                 }
             }
         }
         /* send the remaining keys */
-        if (!pipe.Send(sizeof(Zp) * (bufferSize - bufferRemaining), buffer))
+        if (!pipe.Send(sizeof(Zp) * (bobOffset[input] - sent), bobKeys + sent))
         {
             comm.Error1 = "Could not send last batch of Bob's keys.";
             return;
@@ -125,6 +260,87 @@ struct BobSendsBobsKeys
     }
 };
 
+/* The state shared by the two halves of Bob's vector OLEs. */
+struct BobVecOlePipeline
+{
+    /* the slots that can take a new vector OLE */
+    BlockingQueue<size_t> FreeSlots;
+    /* the jobs still to be done, including failed ones */
+    BlockingQueue<size_t> Jobs;
+    /* the slots whose E(r,a)+e has been sent, in order */
+    BlockingQueue<size_t> InFlight;
+    /* held while a message is being sent on connection 2 */
+    std::mutex SendMutex;
+    char const *SendError;
+    BobVecOlePipeline()
+        : SendError(nullptr)
+    { }
+};
+
+struct BobSendsVecOleEncodings
+{
+    ExecutionContext *context;
+    BobVecOlePipeline *pipeline;
+
+    BobSendsVecOleEncodings(ExecutionContext *context_, BobVecOlePipeline *pipeline_)
+        : context(context_), pipeline(pipeline_)
+    { }
+
+    void operator () () const
+    {
+        auto &comm = context->Communication;
+        auto &prgole = context->PseudorandomOLE;
+        auto &vecole = context->VectorOLE;
+        auto &bob = context->Bob;
+        auto const &jobs = vecole.Jobs;
+        auto &slots = vecole.Slots;
+        auto const U = vecole.U;
+        auto const V = vecole.V;
+        auto const packedSize = PackedNotNoisySize(U + V);
+        SocketWrappers::SocketConsumer pipe = comm.Socket2.RawValue();
+        std::random_device randomSource;
+        RNG seeds;
+        seeds.Seed(randomSource);
+        /* the first attempt of each job uses the precomputed material */
+        std::vector<bool> attempted(jobs.size(), context->Precomputed.File == nullptr);
+        uint64_t sequence = 0;
+        size_t slotIndex, jobIndex;
+        while (pipeline->FreeSlots.Pop(slotIndex) && pipeline->Jobs.Pop(jobIndex))
+        {
+            auto &slot = slots[slotIndex];
+            auto const &job = jobs[jobIndex];
+            auto const aliceInte = prgole.KeyPairs.AliceIntercept.data()
+                + prgole.KeyPairs.AliceOffset[job.Seed] + job.Offset;
+            auto const vecE = slot.VecE.data();
+            slot.Sequence = sequence++;
+            slot.Job = jobIndex;
+            if (attempted[jobIndex])
+                BobEncodesVecOle(context, prgole.KeyPairs, jobIndex, seeds, slot);
+            else
+            {
+                memcpy(vecE, bob.VecOleEncodings.data() + jobIndex * (U + V), sizeof(Zp) * (U + V));
+                UnpackNotNoisy(bob.VecOleNotNoisy.data() + jobIndex * packedSize, slot.VecNotNoisy);
+                attempted[jobIndex] = true;
+            }
+            /* resetting the unused part of VecMTmp is unnecessary */
+            memcpy(slot.VecMTmp.data(), aliceInte, sizeof(Zp) * job.Count);
+            /* send E(r,a)+e to Alice */
+            VectorOLEHeader header{ EncodedVecOleMessage, slot.Sequence, jobIndex };
+            {
+                std::lock_guard<std::mutex> lock(pipeline->SendMutex);
+                if (!pipe.Send(sizeof(header), &header)
+                    || !pipe.Send(sizeof(Zp) * (U + V), vecE))
+                {
+                    pipeline->SendError = "Could not send E(r,a)+e to Alice.";
+                    break;
+                }
+            }
+            pipeline->InFlight.Push(slotIndex);
+        }
+        pipeline->InFlight.Close();
+    }
+};
+
 struct BobDoesVecOle
 {
     ExecutionContext *context;
@@ -136,152 +352,130 @@ struct BobDoesVecOle
     void operator () () const
     {
         auto &comm = context->Communication;
-        auto &prgole = context->PseudorandomOLE;
         auto &vecole = context->VectorOLE;
         auto &stat = context->Statistics;
-        auto const *aliceConfig = prgole.Config.AliceEncoding.data();
-        auto const *aliceCoef = prgole.KeyPairs.AliceCoefficient.data();
-        auto const *aliceInte = prgole.KeyPairs.AliceIntercept.data();
+        auto const &jobs = vecole.Jobs;
+        auto &slots = vecole.Slots;
         auto const vecoleK = vecole.K;
-        auto const prgoleK = prgole.K;
         auto const U = vecole.U;
-        auto const V = vecole.V;
         auto const W = vecole.W;
-        auto const vecR = vecole.VecR.data();
-        auto const vecE = vecole.VecE.data();
-        auto const vecM = vecole.VecM.data();
-        auto const vecMTmp = vecole.VecMTmp.data();
-        auto &vecNotNoisy = vecole.VecNotNoisy;
-        auto &vecSolved = vecole.VecSolved;
-        auto &sparse = vecole.SparseCode;
-        auto &luby = vecole.LubyCode;
-        auto &lubySurrogate = vecole.LubyCodeSurrogate;
+        auto const &sparse = vecole.CompactSparseCode;
+        auto const &luby = vecole.CompactLubyCode;
         auto &bob = context->Bob;
-        auto const vecGE = bob.VecGE.data();
-        auto const vecGEsz = bob.VecGE.size();
+        auto const &sparseSchedule = bob.SparseSchedule;
+        auto &sparseWorkspace = bob.SparseWorkspace;
+        auto const &lubyIndex = bob.LubyIndex;
+        auto &lubyWorkspace = bob.LubyWorkspace;
         SocketWrappers::SocketConsumer pipe = comm.Socket2.RawValue();
-        if (!pipe.Send(8, &HelloMessage))
+        uint64_t const window = slots.size();
+        if (!pipe.Send(8, &HelloMessage) || !pipe.Send(8, &window))
         {
             comm.Error2 = "Could not send hello message.";
             return;
         }
-        std::random_device randomSource;
-        for (size_t i = 0; i != prgoleK; ++i)
+        BobVecOlePipeline pipeline;
+        for (size_t i = 0; i != slots.size(); ++i)
+            pipeline.FreeSlots.Push(i);
+        for (size_t i = 0; i != jobs.size(); ++i)
+            pipeline.Jobs.Push(i);
+        Latch sent{1};
+        context->Workers.Submit(BobSendsVecOleEncodings{context, &pipeline}, sent);
+        char const *error = nullptr;
+        size_t slotIndex;
+        for (size_t remaining = jobs.size(); remaining; )
         {
-            auto const *aliceCoefI = (aliceCoef++)->data();
-            auto const *aliceInteI = (aliceInte++)->data();
-            for (size_t j = 0, jsz = *aliceConfig++; j != jsz; )
+            /* the sender stops early only on errors */
+            if (!pipeline.InFlight.Pop(slotIndex))
+                break;
+            auto &slot = slots[slotIndex];
+            auto const vecR = slot.VecR.data();
+            auto const vecE = slot.VecE.data();
+            auto const vecM = slot.VecM.data();
+            auto const &vecNotNoisy = slot.VecNotNoisy;
+            VectorOLEHeader header;
+            if (!pipe.Receive(sizeof(header), &header))
+            {
+                error = "Could not receive E(xr+r',xa+b') from Alice.";
+                break;
+            }
+            if (header.Message != ReplyVecOleMessage
+                || header.Sequence != slot.Sequence
+                || header.Job != slot.Job)
+            {
+                error = "Bad vector OLE reply. Misaligned stream?";
+                break;
+            }
+            /* emulate OT */
+            if (!pipe.Skip(sizeof(Zp) * (U + vecole.V)))
+            {
+                error = "Could not emulate OT with Alice.";
+                break;
+            }
+            /* receive E(xr+r',xa+b') from Alice */
+            if (!pipe.Receive(sizeof(Zp) * (U + vecole.V), vecE))
+            {
+                error = "Could not receive E(xr+r',xa+b') from Alice.";
+                break;
+            }
+            /* try computing xa+b' */
+            /* find xr+r' */
+            bool decoded = SparseDecodeScheduled(sparseSchedule,
+                vecE, vecNotNoisy.begin(),
+                vecR, sparseWorkspace, InverseZp);
+            if (decoded)
             {
-                /* sample r */
-                auto distR = MakeUZp();
-                RNG nextR{randomSource()};
-                std::thread sampR{SampleRandomVector(vecR, vecR + vecoleK, nextR, distR)};
-                /* sample e */
-                RNG nextSubset{randomSource()};
-                vecNotNoisy.clear();
-                vecNotNoisy.resize(U + V, true);
-                EraseSubsetExact(vecNotNoisy.begin(), vecNotNoisy.begin() + U,
-                    U / 4, nextSubset);
-                EraseSubsetExact(vecNotNoisy.begin() + U, vecNotNoisy.begin() + U + V,
-                    V / 4, nextSubset);
-                /* prepare for computing E(r,a)+e */
-                memset(vecE, 0, sizeof(Zp) * (U + V));
-                if (jsz - j < W)
-                {
-                    memcpy(vecM, aliceCoefI + j, sizeof(Zp) * (jsz - j));
-                    /* reset unused part of vecM to prevent accidental leakage */
-                    memset(vecM + (jsz - j), 0, sizeof(Zp) * (W - (jsz - j)));
-                    memcpy(vecMTmp, aliceInteI + j, sizeof(Zp) * (jsz - j));
-                    /* resetting vecMTmp is unnecessary */
-                }
-                else
-                {
-                    memcpy(vecM, aliceCoefI + j, sizeof(Zp) * W);
-                    memcpy(vecMTmp, aliceInteI + j, sizeof(Zp) * W);
-                }
-                /* finish sampling r */
-                sampR.join();
-                /* compute E(r,a) */
-                sparse.EncodeBothParts(vecE, vecNotNoisy.begin(), vecR);
-                luby.Encode(vecE + U, vecNotNoisy.begin() + U, vecM);
-                /* compute E(r,a)+e */
-                for (size_t i = 0; i != U + V; ++i)
-                    if (!vecNotNoisy[i])
-                        vecE[i] = distR(nextR);
-                /* send E(r,a)+e to Alice */
-                if (!pipe.Send(sizeof(Zp) * (U + V), vecE))
-                {
-                    comm.Error2 = "Could not send E(r,a)+e to Alice.";
-                    return;
-                }
-                /* emulate OT */
-                if (!pipe.Skip(sizeof(Zp) * (U + V)))
-                {
-                    comm.Error2 = "Could not emulate OT with Alice.";
-                    return;
-                }
-                /* receive E(xr+r',xa+b') from Alice */
-                if (!pipe.Receive(sizeof(Zp) * (U + V), vecE))
-                {
-                    comm.Error2 = "Could not receive E(xr+r',xa+b') from Alice.";
-                    return;
-                }
-                /* try computing xa+b' */
-                memset(vecGE, 0, sizeof(Zp) * vecGEsz);
-                /* find xr+r' */
-                if (!sparse.DecodeFromUpperPartDestructive(
-                    vecE, vecNotNoisy.begin(),
-                    vecR, vecGE, InverseZp))
-                {
-                    if (!pipe.Send(8, &FailedVecOleMessage))
-                    {
-                        comm.Error2 = "Could not send failed vector OLE message.";
-                        return;
-                    }
-                    ++stat.UnsuccessfulVectorOLE;
-                    continue;
-                }
                 /* compute -(xr+r') */
-                for (auto z = vecR, zend = vecR + vecoleK; z != zend; ++z)
-                    *z = -*z;
+                FieldKernels::Negate(vecR, vecR, vecoleK);
                 /* find E(0,xa+b') */
                 sparse.EncodeLowerPart(vecE + U, vecNotNoisy.begin() + U, vecR);
-                vecSolved.clear();
-                vecSolved.resize(W, false);
-                lubySurrogate = luby;
                 /* find xa+b' */
-                if (!lubySurrogate.DecodeDestructive(
-                    vecSolved.begin(), vecSolved.end(),
-                    vecM,
-                    vecNotNoisy.begin() + U,
-                    vecNotNoisy.end(),
-                    vecE + U, vecE + U + V))
-                {
-                    if (!pipe.Send(8, &FailedVecOleMessage))
-                    {
-                        comm.Error2 = "Could not send failed vector OLE message.";
-                        return;
-                    }
-                    ++stat.UnsuccessfulVectorOLE;
-                    continue;
-                }
-                if (!pipe.Send(8, &SuccessfulVecOleMessage))
-                {
-                    comm.Error2 = "Could not send successful vector OLE message.";
-                    return;
-                }
+                decoded = luby.DecodeInactivation(lubyIndex,
+                    vecM, vecNotNoisy.begin() + U,
+                    vecE + U, lubyWorkspace,
+                    InverseZp, MaxInactivatedLubySymbols);
+                stat.InactivatedLubySymbols += lubyWorkspace.Inactivated;
+            }
+            header.Message = (decoded ? SuccessfulVecOleMessage : FailedVecOleMessage);
+            if (decoded)
+            {
                 /* compute b+xa+b' */
-                for (size_t k = 0; k != W && j != jsz; ++k, ++j)
-                    vecM[k] += vecMTmp[k];
-                if (!pipe.Send(sizeof(Zp) * W, vecM))
+                FieldKernels::Add(vecM, vecM, slot.VecMTmp.data(), jobs[slot.Job].Count);
+                std::lock_guard<std::mutex> lock(pipeline.SendMutex);
+                if (!pipe.Send(sizeof(header), &header)
+                    || !pipe.Send(sizeof(Zp) * W, vecM))
                 {
-                    comm.Error2 = "Could not send b+xa+b' to Alice.";
-                    return;
+                    error = "Could not send b+xa+b' to Alice.";
+                    break;
                 }
                 ++stat.SuccessfulVectorOLE;
+                --remaining;
             }
+            else
+            {
+                std::lock_guard<std::mutex> lock(pipeline.SendMutex);
+                if (!pipe.Send(sizeof(header), &header))
+                {
+                    error = "Could not send failed vector OLE message.";
+                    break;
+                }
+                ++stat.UnsuccessfulVectorOLE;
+                /* redo it from scratch */
+                pipeline.Jobs.Push(slot.Job);
+            }
+            pipeline.FreeSlots.Push(slotIndex);
         }
-        if (!pipe.Send(8, &ByeByeMessage))
+        pipeline.Jobs.Close();
+        pipeline.FreeSlots.Close();
+        sent.Wait();
+        if (!error)
+            error = pipeline.SendError;
+        if (error)
+        {
+            comm.Error2 = error;
+            return;
+        }
+        VectorOLEHeader const byeBye{ ByeByeMessage, 0, 0 };
+        if (!pipe.Send(sizeof(byeBye), &byeBye))
         {
             comm.Error2 = "Could not send bye-bye message.";
             return;
@@ -327,8 +521,8 @@ struct BobEliminatesCryptoBlinding
             return;
         }
         /* compute v=a*D+b-c */
-        for (size_t i = 0; i != M; ++i)
-            vecDV[i] = vecA[i] * vecDV[i] + (vecB[i] - vecC[i]);
+        FieldKernels::MultiplyAdd(vecDV, vecA, vecDV, vecB, M);
+        FieldKernels::Subtract(vecDV, vecDV, vecC, M);
         /* send v to Alice */
         if (!pipe.Send(sizeof(Zp) * M, vecDV))
         {
@@ -360,10 +554,11 @@ int PlayBob()
     BobConnectsSocket bcs1{CommandLineParameters.ServerAddress, CommandLineParameters.Port1, &comm.Socket1};
     BobConnectsSocket bcs2{CommandLineParameters.ServerAddress, CommandLineParameters.Port2, &comm.Socket2};
     BobConnectsSocket bcs3{CommandLineParameters.ServerAddress, CommandLineParameters.Port3, &comm.Socket3};
-    std::thread bcst1{bcs1};
-    std::thread bcst2{bcs2};
-    std::thread bcst3{bcs3};
-    bcst1.join(); bcst2.join(); bcst3.join();
+    Latch connected{3};
+    context.Workers.Submit(bcs1, connected);
+    context.Workers.Submit(bcs2, connected);
+    context.Workers.Submit(bcs3, connected);
+    connected.Wait();
     if (!comm.Socket1.IsValid()
         || !comm.Socket2.IsValid()
         || !comm.Socket3.IsValid())
@@ -374,26 +569,44 @@ int PlayBob()
     PrintHelpfulInformation("Connected to Alice.");
     PrintHelpfulInformation("Executing batch OLEs.");
     std::random_device randomSource;
-    auto const K = prgole.K;
-    auto const M = prgole.M;
-    auto const vecC = bob.VecC.data();
-    auto const vecDV = bob.VecDV.data();
-    auto &configSurrogate = prgole.ConfigSurrogate;
-    auto &circuit = prgole.Circuit;
-    auto &keypairs = prgole.KeyPairs;
+    RNG seeds;
+    seeds.Seed(randomSource);
+    RNG batchSeeds;
+    auto const precomputed = (context.Precomputed.File != nullptr);
     auto startTime = Clock::now();
+    batchSeeds.Seed(seeds);
+    if (precomputed)
+        BobLoadsBatch{&context}();
+    else
+        BobGarblesBatch{&context, batchSeeds}();
     for (auto i = CommandLineParameters.ExecutionCount; i--; )
     {
-        RNG nextC{randomSource()}, nextGC{randomSource()};
-        auto distC = MakeUZp(); auto distGC = MakeUZp();
-        std::thread randC{SampleRandomVector(vecC, vecC + M, nextC, distC)};
-        configSurrogate.ResetPreserveConfiguration();
-        Garbled2::Garble(circuit, configSurrogate, keypairs, nextGC, distGC);
-        randC.join();
-        std::thread sendBob{BobSendsBobsKeys{&context}};
-        std::thread unblinding{BobEliminatesCryptoBlinding{&context}};
+        if (context.Precomputed.Error)
+        {
+            PrintHelpfulInformation(context.Precomputed.Error);
+            return -13;
+        }
+        bob.VecC.swap(bob.NextVecC);
+        std::swap(prgole.KeyPairs, prgole.NextKeyPairs);
+        bob.VecOleEncodings.swap(bob.NextVecOleEncodings);
+        bob.VecOleNotNoisy.swap(bob.NextVecOleNotNoisy);
+        /* garble or load the next batch while this one is on the wire */
+        Latch garbled{1};
+        if (!i)
+            garbled.CountDown();
+        else if (precomputed)
+            context.Workers.Submit(BobLoadsBatch{&context}, garbled);
+        else
+        {
+            batchSeeds.Seed(seeds);
+            context.Workers.Submit(BobGarblesBatch{&context, batchSeeds}, garbled);
+        }
+        Latch sendBobAndUnblinding{2};
+        context.Workers.Submit(BobSendsBobsKeys{&context}, sendBobAndUnblinding);
+        context.Workers.Submit(BobEliminatesCryptoBlinding{&context}, sendBobAndUnblinding);
         BobDoesVecOle{&context}();
-        sendBob.join(); unblinding.join();
+        sendBobAndUnblinding.Wait();
+        garbled.Wait();
         if (comm.HasErrors())
         {
             comm.PrintErrors();
@@ -408,3 +621,57 @@ int PlayBob()
     PrintHelpfulInformation("Done.");
     return 0;
 }
+
+int PrecomputeBob()
+{
+    ExecutionContext context;
+    auto &prgole = context.PseudorandomOLE;
+    auto &vecole = context.VectorOLE;
+    auto &bob = context.Bob;
+    auto &keypairs = prgole.NextKeyPairs;
+    auto prepareResult = InitBobContext(&context);
+    if (!prepareResult)
+        prepareResult = CreatePrecomputed(&context, BobPrecomputedMagic);
+    if (prepareResult)
+    {
+        PrintHelpfulInformation(prepareResult);
+        return -10;
+    }
+    PrintHelpfulInformation("Precomputing batches.");
+    auto const fp = context.Precomputed.File;
+    auto const UV = vecole.U + vecole.V;
+    auto &slot = vecole.Slots.front();
+    std::vector<uint8_t> packed(PackedNotNoisySize(UV));
+    std::random_device randomSource;
+    RNG seeds;
+    seeds.Seed(randomSource);
+    RNG batchSeeds;
+    for (auto i = CommandLineParameters.ExecutionCount; i--; )
+    {
+        batchSeeds.Seed(seeds);
+        BobGarblesBatch{&context, batchSeeds}();
+        bool good = WriteZp(fp, bob.NextVecC.data(), prgole.M);
+        for (auto vec : { &keypairs.BobCoefficient, &keypairs.BobIntercept,
+            &keypairs.AliceCoefficient, &keypairs.AliceIntercept })
+            good = good && WriteZp(fp, vec->data(), vec->size());
+        for (size_t j = 0; good && j != vecole.Jobs.size(); ++j)
+        {
+            BobEncodesVecOle(&context, keypairs, j, seeds, slot);
+            PackNotNoisy(slot.VecNotNoisy, packed.data());
+            good = WriteZp(fp, slot.VecE.data(), UV)
+                && fwrite(packed.data(), 1, packed.size(), fp) == packed.size();
+        }
+        if (!good)
+        {
+            PrintHelpfulInformation("file: Could not write the material of a batch.");
+            return -13;
+        }
+    }
+    if (fflush(fp) != 0)
+    {
+        PrintHelpfulInformation("file: Could not write the material of a batch.");
+        return -13;
+    }
+    PrintHelpfulInformation("Done.");
+    return 0;
+}
@@ -1,20 +1,9 @@
+/* ZMontgomery<4294967291u> is a drop-in replacement. */
 typedef Z<4294967291u> Zp;
-typedef std::mt19937 RNG;
-
-struct ZpUniformDistribution
-{
-    std::uniform_int_distribution<uint32_t> underlying;
-    
-    ZpUniformDistribution()
-        : underlying(0u, 4294967290u)
-    { }
-
-    template <typename TRandomGenerator>
-    Zp operator () (TRandomGenerator &next)
-    {
-        return underlying(next);
-    }
-};
+/* Each agent seeds one generator from std::random_device, and seeds
+ * the generators of the vectors it samples from that one. */
+typedef ChaCha20Generator RNG;
+typedef UniformRingDistribution<Zp> ZpUniformDistribution;
 
 ZpUniformDistribution MakeUZp()
 {
@@ -27,6 +16,12 @@ void PrintHelpfulInformation(char const *info)
     fputc('\n', stderr);
 }
 
+/* The most tasks that run at once: each agent transfers Bob's keys,
+ * eliminates the blinding and prepares the next batch while sending
+ * its vector OLE messages. The garbling and ungarbling split their
+ * outputs over the idle workers and the thread that waits for them. */
+constexpr size_t WorkerThreads = 4;
+
 struct ExecutionContext
 {
     struct CommunicationTag
@@ -63,12 +58,37 @@ struct ExecutionContext
     struct VectorOLETag
     {
         size_t K, U, V, W;
-        LTCode<> LubyCode, LubyCodeSurrogate;
+        LTCode<> LubyCode;
+        /* LubyCode with 16-bit indices, used for encoding and decoding */
+        CompactLTCode<uint16_t> CompactLubyCode;
+        /* CompactLubyCode transposed for encoding */
+        LTEncodeSchedule<uint16_t> LubyEncodeSchedule;
         FastSparseLinearCode<Zp> SparseCode;
+        /* SparseCode with 16-bit columns, used for encoding */
+        CompactSparseLinearCode<Zp, uint16_t> CompactSparseCode;
+        /* the vector OLEs of a batch: each gives Count keys of
+         * AliceEncoding[Seed] from Offset on */
+        struct JobTag
+        {
+            size_t Seed, Offset, Count;
+        };
+        std::vector<JobTag> Jobs;
+        /* an in-flight vector OLE, at its sequence number modulo the
+         * window (Alice uses VecE and VecMTmp only) */
+        struct SlotTag
+        {
+            uint64_t Sequence;
+            size_t Job;
+            std::vector<Zp> VecR;
+            std::vector<Zp> VecE;
+            std::vector<Zp> VecM;
+            std::vector<Zp> VecMTmp;
+            std::vector<bool> VecNotNoisy;
+        };
+        std::vector<SlotTag> Slots;
+        /* Alice's r' and received b+xa+b' */
         std::vector<Zp> VecR;
-        std::vector<Zp> VecE;
         std::vector<Zp> VecM;
-        std::vector<Zp> VecMTmp;
         VectorOLETag()
             : K(0), U(0), V(0), W(0)
         { }
@@ -87,18 +107,20 @@ struct ExecutionContext
                 return true;
             }
         } ItNeverNoisy; /* It = iterator, not a grammar mistake here. */
-        std::vector<bool> VecNotNoisy;
-        std::vector<bool> VecSolved;
     } VectorOLE;
     struct PseudorandomOLETag
     {
         size_t K, M;
         GoldreichGraph<> GoldreichFunc;
         TwoPartyCircuit<> Circuit;
+        /* the circuit expanded once into the order of garbling */
+        Garbled2::Program<> Program;
         Garbled2::Configuration<> Config;
-        Garbled2::Configuration<> ConfigSurrogate;
-        Garbled2::KeyPairs<Zp> KeyPairs;
-        Garbled2::Keys<Zp> Keys;
+        /* Bob's keys of the batch are computed into KeyPairs.BobIntercept */
+        Garbled2::FlatKeyPairs<Zp> KeyPairs;
+        /* Bob garbles the next batch into it while KeyPairs is in use */
+        Garbled2::FlatKeyPairs<Zp> NextKeyPairs;
+        Garbled2::FlatKeys<Zp> Keys;
         PseudorandomOLETag()
             : K(0), M(0)
         { }
@@ -116,6 +138,12 @@ struct ExecutionContext
          * z = a * x + b = u + v, computed by Alice.
          */
         std::vector<Zp> VecDVZ;
+        /* VecS and D of the next batch, prepared while this one runs */
+        std::vector<Zp> NextVecS, NextVecDVZ;
+        /* precomputed E(r',b') and b' of each vector OLE job, empty
+         * unless the material of the offline phase is given */
+        std::vector<Zp> VecOleMasks, NextVecOleMasks;
+        std::vector<Zp> VecOleBp, NextVecOleBp;
     } Alice;
     struct BobTag
     {
@@ -123,30 +151,65 @@ struct ExecutionContext
         std::vector<Zp> VecA, VecB;
         /* random */
         std::vector<Zp> VecC;
+        /* VecC of the next batch, sampled while this one runs */
+        std::vector<Zp> NextVecC;
+        /* precomputed E(r,a)+e and its packed noise mask of each vector
+         * OLE job, empty unless the material of the offline phase is
+         * given */
+        std::vector<Zp> VecOleEncodings, NextVecOleEncodings;
+        std::vector<uint8_t> VecOleNotNoisy, NextVecOleNotNoisy;
         /* D = x - G(s), from Alice;
          * v = a * D + b - c, sent to Alice.
          */
         std::vector<Zp> VecDV;
-        /* buffers Bob's keys */
-        std::vector<Zp> VecBuf;
-        /* temporary vector for Gaussian elimination */
-        std::vector<Zp> VecGE;
+        /* the upper part of the sparse code, prepared for decoding */
+        StructuredDecodeSchedule<Zp> SparseSchedule;
+        /* workspace for decoding the sparse code */
+        StructuredDecodeWorkspace<Zp> SparseWorkspace;
+        /* the bins of each input of the Luby code, prepared for decoding */
+        LTPeelingIndex LubyIndex;
+        /* workspace for decoding the Luby code */
+        LTDecodeWorkspace<Zp> LubyWorkspace;
     } Bob;
     struct StatisticsTag
     {
         double TotalSeconds;
         size_t SuccessfulVectorOLE;
         size_t UnsuccessfulVectorOLE;
+        /* Bob only */
+        size_t InactivatedLubySymbols;
         size_t AliceKeyLength, BobKeyLength;
         size_t VectorOLEPerBatchOLE;
         StatisticsTag()
             : TotalSeconds(0),
             SuccessfulVectorOLE(0),
             UnsuccessfulVectorOLE(0),
+            InactivatedLubySymbols(0),
             AliceKeyLength(0), BobKeyLength(0),
             VectorOLEPerBatchOLE(0)
         { }
     } Statistics;
+    struct PrecomputedTag
+    {
+        /* the material of the offline phase being written or read */
+        FILE *File;
+        /* set when reading the material of a batch fails */
+        char const *Error;
+        PrecomputedTag()
+            : File(nullptr), Error(nullptr)
+        { }
+        ~PrecomputedTag()
+        {
+            if (File)
+                fclose(File);
+        }
+    } Precomputed;
+    /* runs the concurrent steps; declared last so that it is joined
+     * before the data of its tasks are destroyed */
+    WorkStealingThreadPool Workers;
+    ExecutionContext()
+        : Workers(WorkerThreads)
+    { }
 };
 
 struct
@@ -158,6 +221,12 @@ struct
     PCString LubyCode, SparseCode, GoldreichFunc;
     PCString AliceX, BobA, BobB;
     size_t ExecutionCount;
+    /* Bob only */
+    size_t VectorOLEWindow;
+    /* whether to write the material of the offline phase */
+    bool IsOffline;
+    /* the material of the offline phase, or nullptr */
+    PCString Precomputed;
 } CommandLineParameters;
 
 constexpr uint64_t PingMessage = 0x42de0135245310ed;
@@ -166,6 +235,30 @@ constexpr uint64_t HelloMessage = 0x4242424242424242;
 constexpr uint64_t ByeByeMessage = 0x8888888888888888;
 constexpr uint64_t SuccessfulVecOleMessage = 0x6666666666666666;
 constexpr uint64_t FailedVecOleMessage = 0x0000000000000000;
+/* E(r,a)+e from Bob and E(xr+r',xa+b') from Alice. */
+constexpr uint64_t EncodedVecOleMessage = 0x4545454545454545;
+constexpr uint64_t ReplyVecOleMessage = 0x5252525252525252;
+/* The number of vector OLEs Bob keeps in flight, unless given. */
+constexpr size_t DefaultVectorOLEWindow = 8;
+constexpr size_t MaxVectorOLEWindow = 64;
+
+/* Start the material of the offline phase of each agent. */
+constexpr uint64_t AlicePrecomputedMagic = 0x416c6963654d6174;
+constexpr uint64_t BobPrecomputedMagic = 0x426f624d61746572;
+
+/* Precedes each vector OLE message on connection 2. */
+struct VectorOLEHeader
+{
+    uint64_t Message;
+    uint64_t Sequence;
+    uint64_t Job;
+};
+/* When LT peeling stalls, Bob inactivates at most this many symbols
+ * before giving the vector OLE up. */
+constexpr size_t MaxInactivatedLubySymbols = 16;
+/* Bob sends his keys in runs of about this many, each as soon as it is
+ * computed. */
+constexpr size_t BobKeysPerSend = 2097152;
 
 void PrintUsage()
 {
@@ -174,7 +267,10 @@ void PrintUsage()
         "Usage: pe2 { alice | ipv4 }\n"
         "           port1 port2 port3\n"
         "           luby sparse prg\n"
-        "           { x | a b } count\n\n"
+        "           { x count [file] | a b count [window [file]] }\n"
+        "       pe2 offline { alice | bob }\n"
+        "           luby sparse prg\n"
+        "           file count\n\n"
         "Parameters:\n"
         "     alice: the literal string \"alice\", runs the\n"
         "            program as Alice.\n"
@@ -187,7 +283,16 @@ void PrintUsage()
         "       prg: the file name of Goldreich's function.\n"
         "         x: the file name of Alice's input.\n"
         "      a, b: the file names of Bob's inputs.\n"
-        "     count: the number of batches to run.\n",
+        "     count: the number of batches to run.\n"
+        "    window: the number of vector OLEs Bob keeps in\n"
+        "            flight (1-64, default 8).\n"
+        "   offline: the literal string \"offline\", writes\n"
+        "            the input-independent material of count\n"
+        "            batches to file.\n"
+        "      file: the file name of the material written\n"
+        "            by the offline phase of the same agent\n"
+        "            with the same luby, sparse and prg, for\n"
+        "            at least count batches.\n",
         stderr
     );
 }
@@ -224,19 +329,53 @@ struct
     }
 } InverseZp;
 
+int ParseExecutionCount(char const *countBuffer)
+{
+    uintmax_t count;
+    if (sscanf(countBuffer, "%ju", &count) != 1 || count < 1 || count > 5000000)
+    {
+        PrintHelpfulInformation("count: must be a natural number from 1 to 5000000.");
+        return -3;
+    }
+    CommandLineParameters.ExecutionCount = count;
+    return 0;
+}
+
+int ParseOfflineCommandLine(int argc, char **argv)
+{
+    if (argc != 8)
+        return 1;
+    if (strcmp(argv[2], "alice") == 0)
+        CommandLineParameters.IsAlice = true;
+    else if (strcmp(argv[2], "bob") == 0)
+        CommandLineParameters.IsAlice = false;
+    else
+        return 1;
+    CommandLineParameters.LubyCode = argv[3];
+    CommandLineParameters.SparseCode = argv[4];
+    CommandLineParameters.GoldreichFunc = argv[5];
+    CommandLineParameters.Precomputed = argv[6];
+    return ParseExecutionCount(argv[7]);
+}
+
 int ParseCommandLine(int argc, char **argv)
 {
-    if (argc != 10 && argc != 11)
+    CommandLineParameters.Precomputed = nullptr;
+    CommandLineParameters.VectorOLEWindow = DefaultVectorOLEWindow;
+    CommandLineParameters.IsOffline = (argc > 1 && strcmp(argv[1], "offline") == 0);
+    if (CommandLineParameters.IsOffline)
+        return ParseOfflineCommandLine(argc, argv);
+    if (argc < 10 || argc > 13)
         return 1;
     if (strcmp(argv[1], "alice") == 0)
     {
-        if (argc != 10)
+        if (argc != 10 && argc != 11)
             return 1;
         CommandLineParameters.IsAlice = true;
     }
     else
     {
-        if (argc != 11)
+        if (argc == 10)
             return 1;
         CommandLineParameters.IsAlice = false;
         CommandLineParameters.ServerAddress = argv[1];
@@ -290,13 +429,27 @@ int ParseCommandLine(int argc, char **argv)
         CommandLineParameters.BobB = argv[9];
         countBuffer = argv[10];
     }
-    uintmax_t count;
-    if (sscanf(countBuffer, "%ju", &count) != 1 || count < 1 || count > 5000000)
+    auto countResult = ParseExecutionCount(countBuffer);
+    if (countResult)
+        return countResult;
+    if (CommandLineParameters.IsAlice)
     {
-        PrintHelpfulInformation("count: must be a natural number from 1 to 5000000.");
-        return -3;
+        if (argc == 11)
+            CommandLineParameters.Precomputed = argv[10];
+        return 0;
     }
-    CommandLineParameters.ExecutionCount = count;
+    if (argc >= 12)
+    {
+        uintmax_t window;
+        if (sscanf(argv[11], "%ju", &window) != 1 || window < 1 || window > MaxVectorOLEWindow)
+        {
+            PrintHelpfulInformation("window: must be a natural number from 1 to 64.");
+            return -3;
+        }
+        CommandLineParameters.VectorOLEWindow = window;
+    }
+    if (argc == 13)
+        CommandLineParameters.Precomputed = argv[12];
     return 0;
 }
 
@@ -306,7 +459,6 @@ char const *LoadLuby(ExecutionContext *context)
     if (!fp)
         return "luby: Could not open file.";
     auto loadResult = context->VectorOLE.LubyCode.LoadFrom(fp);
-    context->VectorOLE.LubyCodeSurrogate = context->VectorOLE.LubyCode;
     fclose(fp);
     return loadResult ? nullptr : "luby: File is not valid Luby code.";
 }
@@ -423,26 +575,34 @@ char const *InitCommonContext(ExecutionContext *context)
         return ret;
     if (luby.Bins.size() != sparse.V)
         return "luby, sparse: Luby code output does not match sparse linear code.";
+    if (!vecole.CompactSparseCode.Assign(sparse))
+        return "sparse: Sparse code has too many columns for 16-bit indices.";
     vecole.K = sparse.K;
     vecole.U = sparse.U;
     vecole.V = sparse.V;
     vecole.W = luby.InputSymbolSize;
+    if (!vecole.CompactLubyCode.Assign(luby))
+        return "luby: Luby code has too many inputs for 16-bit indices.";
+    /* 0xFFFF pads the bins of the schedule, so 65535 inputs at most */
+    if (!vecole.CompactLubyCode.BuildEncodeSchedule(vecole.LubyEncodeSchedule))
+        return "luby: Luby code has more than 65535 inputs, too many for the 16-bit encoding schedule.";
     vecole.VecR.resize(vecole.K);
-    vecole.VecE.resize(vecole.U + vecole.V);
     vecole.VecM.resize(vecole.W);
-    vecole.VecMTmp.resize(vecole.W);
     BuildPseudorandomOLECircuit{context}();
     prgole.K = prgole.GoldreichFunc.InputLength;
     prgole.M = prgole.GoldreichFunc.OutputLength;
-    Garbled2::Configure(prgole.Circuit, prgole.Config);
-    prgole.ConfigSurrogate = prgole.Config;
+    Garbled2::Compile(prgole.Circuit, prgole.Program);
+    Garbled2::Configure(prgole.Program, prgole.Config);
     prgole.KeyPairs.ApplyConfiguration(prgole.Config);
     prgole.Keys.ApplyConfiguration(prgole.Config);
-    for (auto i : prgole.Config.AliceEncoding)
+    for (size_t i = 0; i != prgole.K; ++i)
     {
-        stat.VectorOLEPerBatchOLE += (i + vecole.W - 1) / vecole.W;
-        stat.AliceKeyLength += i;
+        auto const keys = prgole.Config.AliceEncoding[i];
+        for (size_t j = 0; j < keys; j += vecole.W)
+            vecole.Jobs.push_back({ i, j, keys - j < vecole.W ? keys - j : vecole.W });
+        stat.AliceKeyLength += keys;
     }
+    stat.VectorOLEPerBatchOLE = vecole.Jobs.size();
     for (auto i : prgole.Config.BobEncoding)
         stat.BobKeyLength += i;
     PrintHelpfulInformation("Finished initialising common execution context.");
@@ -460,10 +620,10 @@ struct SampleRandomVectorTag
         : begin(begin_), end(end_), next(&next_), dist(&dist_)
     { }
 
+    /* in bulk for Zp * and RNG, see UniformRingDistribution::Fill */
     void operator () ()
     {
-        for (; begin != end; ++begin)
-            *begin = (*dist)(*next);
+        dist->Fill(begin, end, *next);
     }
 };
 
@@ -475,6 +635,98 @@ SampleRandomVector(TIt begin, TIt end, TRandomGenerator &next, TDistribution &di
         (begin, end, next, dist);
 }
 
+/* The material of the offline phase is a header of the magic number of
+ * the agent, the number of batches and the parameters below, then the
+ * material of each batch, in machine endianness. */
+constexpr size_t PrecomputedParameterCount = 9;
+
+void GetPrecomputedParameters(ExecutionContext const *context, uint64_t *parameters)
+{
+    auto const &vecole = context->VectorOLE;
+    auto const &prgole = context->PseudorandomOLE;
+    auto const &stat = context->Statistics;
+    parameters[0] = vecole.K;
+    parameters[1] = vecole.U;
+    parameters[2] = vecole.V;
+    parameters[3] = vecole.W;
+    parameters[4] = prgole.K;
+    parameters[5] = prgole.M;
+    parameters[6] = stat.AliceKeyLength;
+    parameters[7] = stat.BobKeyLength;
+    parameters[8] = vecole.Jobs.size();
+}
+
+char const *CreatePrecomputed(ExecutionContext *context, uint64_t magic)
+{
+    auto &precomputed = context->Precomputed;
+    precomputed.File = fopen(CommandLineParameters.Precomputed, "wb");
+    if (!precomputed.File)
+        return "file: Could not create file.";
+    uint64_t header[2 + PrecomputedParameterCount];
+    header[0] = magic;
+    header[1] = CommandLineParameters.ExecutionCount;
+    GetPrecomputedParameters(context, header + 2);
+    if (fwrite(header, sizeof(header), 1, precomputed.File) != 1)
+        return "file: Could not write the header.";
+    return nullptr;
+}
+
+/* Checks the header, and that the file holds batchSize bytes for each
+ * batch. */
+char const *OpenPrecomputed(ExecutionContext *context, uint64_t magic, size_t batchSize)
+{
+    auto &precomputed = context->Precomputed;
+    precomputed.File = fopen(CommandLineParameters.Precomputed, "rb");
+    if (!precomputed.File)
+        return "file: Could not open file.";
+    uint64_t header[2 + PrecomputedParameterCount];
+    uint64_t parameters[PrecomputedParameterCount];
+    if (fread(header, sizeof(header), 1, precomputed.File) != 1)
+        return "file: Could not read the header.";
+    if (header[0] != magic)
+        return "file: Not the material of this agent.";
+    if (header[1] < CommandLineParameters.ExecutionCount)
+        return "file: Fewer batches than count.";
+    GetPrecomputedParameters(context, parameters);
+    if (memcmp(header + 2, parameters, sizeof(parameters)) != 0)
+        return "file: The material is for other codes or another function.";
+    if (fseek(precomputed.File, 0, SEEK_END) != 0
+        || (uint64_t)ftell(precomputed.File) != sizeof(header) + header[1] * batchSize
+        || fseek(precomputed.File, sizeof(header), SEEK_SET) != 0)
+        return "file: The file is truncated.";
+    return nullptr;
+}
+
+bool WriteZp(FILE *fp, Zp const *v, size_t n)
+{
+    return fwrite(v, sizeof(Zp), n, fp) == n;
+}
+
+bool ReadZp(FILE *fp, Zp *v, size_t n)
+{
+    return fread(v, sizeof(Zp), n, fp) == n;
+}
+
+/* The noise mask of a vector OLE is stored 8 positions per byte. */
+size_t PackedNotNoisySize(size_t n)
+{
+    return (n + 7) / 8;
+}
+
+void PackNotNoisy(std::vector<bool> const &notNoisy, uint8_t *packed)
+{
+    memset(packed, 0, PackedNotNoisySize(notNoisy.size()));
+    for (size_t i = 0; i != notNoisy.size(); ++i)
+        if (notNoisy[i])
+            packed[i / 8] |= (uint8_t)(1u << (i % 8));
+}
+
+void UnpackNotNoisy(uint8_t const *packed, std::vector<bool> &notNoisy)
+{
+    for (size_t i = 0; i != notNoisy.size(); ++i)
+        notNoisy[i] = ((packed[i / 8] >> (i % 8)) & 1) != 0;
+}
+
 void PrintStatistics(ExecutionContext const *context)
 {
     auto const n = CommandLineParameters.ExecutionCount;
@@ -490,7 +742,8 @@ void PrintStatistics(ExecutionContext const *context)
         "         Alice key length: %zu\n"
         "           Bob key length: %zu\n"
         "       Failed vector OLEs: %zu\n"
-        "   Successful vector OLEs: %zu\n",
+        "   Successful vector OLEs: %zu\n"
+        "   Inactivated LT symbols: %zu\n",
         stat.TotalSeconds / 60,
         stat.TotalSeconds / n,
         stat.TotalSeconds * 1000 / (stat.UnsuccessfulVectorOLE + stat.SuccessfulVectorOLE),
@@ -499,5 +752,6 @@ void PrintStatistics(ExecutionContext const *context)
         stat.AliceKeyLength,
         stat.BobKeyLength,
         stat.UnsuccessfulVectorOLE,
-        stat.SuccessfulVectorOLE);
+        stat.SuccessfulVectorOLE,
+        stat.InactivatedLubySymbols);
 }
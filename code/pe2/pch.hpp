@@ -1,11 +1,14 @@
 #include"../library/cryptography.hpp"
+#include"../library/field_kernels.hpp"
 #include"../library/arithmetic_circuits.hpp"
 #include"../library/garbled_circuits2.hpp"
 #include"../library/goldreich.hpp"
 #include"../library/erasure.hpp"
 #include"../library/sparse_code.hpp"
 #include"../library/luby.hpp"
+#include"../library/prg.hpp"
 #include"../library/socket_wrappers.hpp"
+#include"../library/thread_pool.hpp"
 #include<cstdio>
 #include<cstring>
 #include<random>
@@ -5,10 +5,12 @@
 using namespace Cryptography;
 using namespace Cryptography::ArithmeticCircuits;
 using namespace Cryptography::Goldreich;
+using namespace Cryptography::Prg;
 using namespace Encoding::Erasure;
 using namespace Encoding::LubyTransform;
 using namespace Encoding::SparseLinearCode;
 using namespace Networking;
+using namespace Concurrency;
 
 using Clock = std::chrono::high_resolution_clock;
 
@@ -29,6 +31,10 @@ int main(int argc, char **argv)
         PrintHelpfulInformation("Could not initialise socket.");
         return -55;
     }
+    if (CommandLineParameters.IsOffline)
+        return CommandLineParameters.IsAlice
+            ? PrecomputeAlice()
+            : PrecomputeBob();
     return CommandLineParameters.IsAlice
         ? PlayAlice()
         : PlayBob();